@@ -18,12 +18,87 @@ using namespace NextPVR::utilities;
 
 namespace NextPVR
 {
+  Request::RequestSlot::RequestSlot(Request& request, eRequestClass requestClass) : m_owner(request), m_class(requestClass)
+  {
+    // a slow call only holds its own slot, other requests keep flowing
+    std::unique_lock<std::mutex> lock(m_owner.m_mutexSlots);
+    if (!CanStart())
+    {
+      auto start = std::chrono::steady_clock::now();
+      m_owner.m_waitingRequests[m_class]++;
+      m_owner.m_slotAvailable.wait(lock, [this] { return CanStart(); });
+      m_owner.m_waitingRequests[m_class]--;
+      if (m_class == StreamingRequest)
+        kodi::Log(ADDON_LOG_DEBUG, "Streaming request queued %d ms", static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
+    }
+    m_owner.m_activeRequests++;
+  }
+
+  Request::RequestSlot::~RequestSlot()
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_owner.m_mutexSlots);
+      m_owner.m_activeRequests--;
+    }
+    // waiters decide between themselves who is next
+    m_owner.m_slotAvailable.notify_all();
+  }
+
+  bool Request::RequestSlot::CanStart() const
+  {
+    // keep one slot free for streaming and one more for foreground calls
+    if (m_owner.m_activeRequests >= MAX_REQUESTS_IN_FLIGHT - m_class)
+      return false;
+    // queued higher priority work goes first
+    for (int higher = StreamingRequest; higher < m_class; higher++)
+    {
+      if (m_owner.m_waitingRequests[higher] > 0)
+        return false;
+    }
+    return true;
+  }
+
+  std::string Request::MethodName(const std::string& resource)
+  {
+    // resource is either method&arguments or a url with method=
+    std::string method = resource;
+    const size_t methodStart = method.find("method=");
+    if (methodStart != std::string::npos)
+      method = method.substr(methodStart + 7);
+    return method.substr(0, method.find('&'));
+  }
+
+  eRequestClass Request::ClassifyRequest(const std::string& resource)
+  {
+    static const char* streamingMethods[] = { "channel.transcode.", "channel.stream." };
+    static const char* backgroundMethods[] = { "recording.list", "recording.recurring.list", "recording.lastupdated", "channel.list",
+                                               "channel.groups", "channel.icon", "system.space", "system.epg.summary" };
+    const std::string method = MethodName(resource);
+
+    // streaming methods are whole families, channel.stream.start, channel.stream.stop ...
+    for (const char* streaming : streamingMethods)
+    {
+      if (kodi::tools::StringUtils::StartsWith(method, streaming))
+        return StreamingRequest;
+    }
+    for (const char* background : backgroundMethods)
+    {
+      if (method == background)
+        return BackgroundRequest;
+    }
+    // static files are only fetched during channel loads
+    if (kodi::tools::StringUtils::StartsWith(method, "/public/"))
+      return BackgroundRequest;
+    // everything else has Kodi waiting on the user's behalf
+    return ForegroundRequest;
+  }
+
   int Request::DoRequest(std::string resource, std::string& response)
   {
     auto start = std::chrono::steady_clock::now();
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
+    RequestSlot slot(*this, ClassifyRequest(resource));
     // build request string, adding SID if requred
-    const std::string URL = kodi::tools::StringUtils::Format("%s%s&sid=%s", m_settings.m_urlBase, resource.c_str(), GetSID());
+    const std::string URL = kodi::tools::StringUtils::Format("%s%s&sid=%s", m_settings.m_urlBase, resource.c_str(), GetSID().c_str());
 
     // ask XBMC to read the URL for us
     int resultCode = HTTP_NOTFOUND;
@@ -60,28 +135,135 @@ namespace NextPVR
     return DoMethodRequest(resource, doc, false) == tinyxml2::XML_SUCCESS;
   }
 
-  tinyxml2::XMLError Request::DoMethodRequest(std::string resource, tinyxml2::XMLDocument& doc, bool compressed)
+  bool Request::GetMethodURL(const std::string& resource, bool compressed, std::string& URL)
   {
-    auto start = std::chrono::steady_clock::now();
-    // return is same on timeout or http return ie 404, 500.
-    tinyxml2::XMLError retError = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
     // build request string, adding SID if requred
-    std::string URL;
-
     if (IsActiveSID())
-      URL = kodi::tools::StringUtils::Format("%s/service?method=%s&sid=%s", m_settings.m_urlBase, resource.c_str(), GetSID());
+      URL = kodi::tools::StringUtils::Format("%s/service?method=%s&sid=%s", m_settings.m_urlBase, resource.c_str(), GetSID().c_str());
     else if (kodi::tools::StringUtils::StartsWith(resource, "session"))
       URL = kodi::tools::StringUtils::Format("%s/service?method=%s", m_settings.m_urlBase, resource.c_str());
     else
-      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+      return false;
 
     if (!compressed)
       URL += "|Accept-Encoding=identity";
+    return true;
+  }
+
+  tinyxml2::XMLError Request::CheckResponse(tinyxml2::XMLDocument& doc)
+  {
+    tinyxml2::XMLError retError = tinyxml2::XML_SUCCESS;
+    const char* attrib = doc.RootElement()->Attribute("stat");
+    if ( attrib == nullptr || strcmp(attrib, "ok"))
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest bad return %s", attrib);
+      retError = tinyxml2::XML_NO_ATTRIBUTE;
+      if (attrib != nullptr && !strcmp(attrib, "fail"))
+      {
+        const tinyxml2::XMLElement* err = doc.RootElement()->FirstChildElement("err");
+        if (err)
+        {
+          const char* code = err->Attribute("code");
+          if (code)
+          {
+            kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest error code %s", code);
+            if (atoi(code) == 8)
+            {
+              ClearSID();
+              retError = tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+              g_pvrclient->ResetConnection();
+            }
+          }
+        }
+      }
+    }
+    else
+    {
+      RenewSID();
+    }
+    return retError;
+  }
+
+  bool Request::IsCoalesced(const std::string& resource)
+  {
+    // read only methods that several Kodi threads ask for at the same time
+    static const char* sharedMethods[] = { "recording.lastupdated", "system.epg.summary", "channel.list", "channel.groups", "setting.list" };
+    const std::string method = MethodName(resource);
+    for (const char* shared : sharedMethods)
+    {
+      if (method == shared)
+        return true;
+    }
+    return false;
+  }
+
+  tinyxml2::XMLError Request::DoMethodRequest(std::string resource, tinyxml2::XMLDocument& doc, bool compressed)
+  {
+    std::string response;
+    if (!IsCoalesced(resource))
+      return FetchMethodResponse(resource, doc, compressed, response);
+
+    // identical requests already on the wire wait for that one instead of making their own
+    const std::string key = compressed ? resource : resource + "|identity";
+    std::shared_ptr<SharedResponse> shared;
+    bool leader = false;
+    {
+      std::unique_lock<std::mutex> lock(m_mutexShared);
+      auto it = m_sharedResponses.find(key);
+      if (it == m_sharedResponses.end())
+      {
+        shared = std::make_shared<SharedResponse>();
+        m_sharedResponses[key] = shared;
+        leader = true;
+      }
+      else
+      {
+        shared = it->second;
+        shared->waiters++;
+        m_sharedDone.wait(lock, [&shared] { return shared->done; });
+      }
+    }
+
+    if (!leader)
+    {
+      // copy the leader's parsed document rather than parsing the text again
+      if (shared->result == tinyxml2::XML_SUCCESS)
+        shared->doc.DeepCopy(&doc);
+      kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d shared", resource.c_str(), shared->result);
+      return shared->result;
+    }
+
+    tinyxml2::XMLError retError = FetchMethodResponse(resource, doc, compressed, response);
+    int waiters;
+    {
+      // nobody can join once it is out of the map
+      std::unique_lock<std::mutex> lock(m_mutexShared);
+      m_sharedResponses.erase(key);
+      waiters = shared->waiters;
+    }
+    if (waiters > 0 && retError == tinyxml2::XML_SUCCESS)
+      doc.DeepCopy(&shared->doc);
+    {
+      std::unique_lock<std::mutex> lock(m_mutexShared);
+      shared->result = retError;
+      shared->done = true;
+    }
+    m_sharedDone.notify_all();
+    return retError;
+  }
+
+  tinyxml2::XMLError Request::FetchMethodResponse(const std::string& resource, tinyxml2::XMLDocument& doc, bool compressed, std::string& response)
+  {
+    auto start = std::chrono::steady_clock::now();
+    // return is same on timeout or http return ie 404, 500.
+    tinyxml2::XMLError retError = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+    RequestSlot slot(*this, ClassifyRequest(resource));
+    std::string URL;
+    if (!GetMethodURL(resource, compressed, URL))
+      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
 
     // ask XBMC to read the URL for us
     kodi::vfs::CFile stream;
-    std::string response;
     if (stream.OpenFile(URL, ADDON_READ_NO_CACHE))
     {
       char buffer[1025]{ 0 };
@@ -93,39 +275,47 @@ namespace NextPVR
       stream.Close();
       retError = doc.Parse(response.c_str());
       if (retError == tinyxml2::XML_SUCCESS)
+        retError = CheckResponse(doc);
+    }
+    int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d", resource.c_str(), retError, response.length(), milliseconds);
+    return retError;
+  }
+
+  tinyxml2::XMLError Request::DoMethodRequest(std::string resource, const std::string& element, utilities::XMLStreamReader::ElementHandler handler, bool compressed)
+  {
+    return DoMethodRequest(resource, ClassifyRequest(resource), element, handler, compressed);
+  }
+
+  tinyxml2::XMLError Request::DoMethodRequest(std::string resource, eRequestClass requestClass, const std::string& element, utilities::XMLStreamReader::ElementHandler handler, bool compressed)
+  {
+    auto start = std::chrono::steady_clock::now();
+    tinyxml2::XMLError retError = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+    RequestSlot slot(*this, requestClass);
+    std::string URL;
+    if (!GetMethodURL(resource, compressed, URL))
+      return tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
+
+    // elements are handed over while the rest of the response is still arriving
+    utilities::XMLStreamReader reader(element, handler);
+    kodi::vfs::CFile stream;
+    if (stream.OpenFile(URL, ADDON_READ_NO_CACHE))
+    {
+      char buffer[16384];
+      ssize_t count;
+      while ((count = stream.Read(buffer, sizeof(buffer))) > 0)
       {
-        const char* attrib = doc.RootElement()->Attribute("stat");
-        if ( attrib == nullptr || strcmp(attrib, "ok"))
-        {
-          kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest bad return %s", attrib);
-          retError = tinyxml2::XML_NO_ATTRIBUTE;
-          if (!strcmp(attrib, "fail"))
-          {
-            const tinyxml2::XMLElement* err = doc.RootElement()->FirstChildElement("err");
-            if (err)
-            {
-              const char* code = err->Attribute("code");
-              if (code)
-              {
-                kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest error code %s", code);
-                if (atoi(code) == 8)
-                {
-                  ClearSID();
-                  retError = tinyxml2::XML_ERROR_FILE_COULD_NOT_BE_OPENED;
-                  g_pvrclient->ResetConnection();
-                }
-              }
-            }
-          }
-        }
-        else
-        {
-          RenewSID();
-        }
+        if (!reader.Feed(buffer, count))
+          break;
       }
+      stream.Close();
+      tinyxml2::XMLDocument doc;
+      retError = reader.Finish(doc);
+      if (retError == tinyxml2::XML_SUCCESS)
+        retError = CheckResponse(doc);
     }
     int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
-    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d", resource.c_str(), retError, response.length(), milliseconds);
+    kodi::Log(ADDON_LOG_DEBUG, "DoMethodRequest %s %d %d %d %d", resource.c_str(), retError, reader.GetBytesRead(), reader.GetElementCount(), milliseconds);
     return retError;
   }
 
@@ -145,15 +335,15 @@ namespace NextPVR
     return xmlReturn;
   }
 
-  int Request::FileCopy(const char* resource, std::string fileName)
+  int Request::FileCopy(const char* resource, std::string fileName, int64_t knownSize)
   {
-    std::unique_lock<std::mutex> lock(m_mutexRequest);
+    RequestSlot slot(*this, ClassifyRequest(resource));
     ssize_t written = 0;
-    m_start = time(nullptr);
+    const time_t start = time(nullptr);
 
 
     char separator = (strchr(resource, '?') == nullptr) ? '?' : '&';
-    const std::string URL = kodi::tools::StringUtils::Format("%s%s%csid=%s", m_settings.m_urlBase, resource, separator, GetSID());
+    const std::string URL = kodi::tools::StringUtils::Format("%s%s%csid=%s", m_settings.m_urlBase, resource, separator, GetSID().c_str());
 
     // ask XBMC to read the URL for us
     int resultCode = HTTP_NOTFOUND;
@@ -161,25 +351,37 @@ namespace NextPVR
     ssize_t datalen;
     if (inputStream.OpenFile(URL, ADDON_READ_NO_CACHE))
     {
+      if (knownSize >= 0 && inputStream.GetLength() == knownSize)
+      {
+        // caller's copy is current, leave before the body is transferred
+        inputStream.Close();
+        kodi::Log(ADDON_LOG_DEBUG, "FileCopy (%s - %s) unchanged", resource, fileName.c_str());
+        return HTTP_NOTMODIFIED;
+      }
+      // write next to the target so a failed transfer never leaves a truncated file behind
+      const std::string tempName = fileName + ".tmp";
       kodi::vfs::CFile outputFile;
-      if (outputFile.OpenFileForWrite(fileName))
+      if (outputFile.OpenFileForWrite(tempName))
       {
-        char buffer[1024];
-        while ((datalen = inputStream.Read( buffer, sizeof(buffer))))
+        std::vector<char> buffer(64 * 1024);
+        while ((datalen = inputStream.Read(buffer.data(), buffer.size())) > 0)
         {
-          outputFile.Write( buffer, datalen);
+          outputFile.Write(buffer.data(), datalen);
           written += datalen;
         }
         inputStream.Close();
         outputFile.Close();
-        resultCode = HTTP_OK;
+        if (written > 0 && (!kodi::vfs::FileExists(fileName) || kodi::vfs::DeleteFile(fileName)) && kodi::vfs::RenameFile(tempName, fileName))
+          resultCode = HTTP_OK;
+        else
+          kodi::vfs::DeleteFile(tempName);
       }
     }
     if (written == 0)
     {
       resultCode = HTTP_BADREQUEST;
     }
-    kodi::Log(ADDON_LOG_DEBUG, "FileCopy (%s - %s) %zu %d %d", resource, fileName.c_str(), resultCode, written, time(nullptr) - m_start);
+    kodi::Log(ADDON_LOG_DEBUG, "FileCopy (%s - %s) %zu %d %d", resource, fileName.c_str(), resultCode, written, time(nullptr) - start);
 
     return resultCode;
   }
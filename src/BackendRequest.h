@@ -8,25 +8,41 @@
 #pragma once
 
 #include "Settings.h"
+#include "utilities/XMLStreamReader.h"
 #if defined(TARGET_WINDOWS)
   #define WIN32_LEAN_AND_MEAN
   #include "windows.h"
 #endif
 #include <kodi/Filesystem.h>
+#include <condition_variable>
 #include <ctime>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include <stdio.h>
 #include <stdlib.h>
 #include "tinyxml2.h"
 
 #define HTTP_OK 200
+#define HTTP_NOTMODIFIED 304
 #define HTTP_NOTFOUND 404
 #define HTTP_BADREQUEST 400
 
+/* maximum number of backend requests allowed on the wire at the same time */
+#define MAX_REQUESTS_IN_FLIGHT 4
 
 
 namespace NextPVR
 {
+  /* scheduling class of a backend request, lower values are served first */
+  enum eRequestClass
+  {
+    StreamingRequest = 0,
+    ForegroundRequest = 1,
+    BackgroundRequest = 2
+  };
+
   class ATTR_DLL_LOCAL Request
   {
   public:
@@ -41,17 +57,19 @@ namespace NextPVR
     int DoRequest(std::string resource, std::string& response);
     bool DoActionRequest(std::string resource);
     tinyxml2::XMLError DoMethodRequest(std::string resource, tinyxml2::XMLDocument& doc, bool compresssed = true);
-    int FileCopy(const char* resource, std::string fileName);
+    tinyxml2::XMLError DoMethodRequest(std::string resource, const std::string& element, utilities::XMLStreamReader::ElementHandler handler, bool compresssed = true);
+    tinyxml2::XMLError DoMethodRequest(std::string resource, eRequestClass requestClass, const std::string& element, utilities::XMLStreamReader::ElementHandler handler, bool compresssed = true);
+    int FileCopy(const char* resource, std::string fileName, int64_t knownSize = -1);
     tinyxml2::XMLError  GetLastUpdate(std::string resource, time_t& last_update);
     bool PingBackend();
     bool OneTimeSetup();
-    const char* GetSID() { return m_sid.c_str(); };
+    std::string GetSID() { std::unique_lock<std::mutex> lock(m_mutexSID); return m_sid; };
     std::vector<std::vector<std::string>> Discovery();
 
-    void SetSID(std::string newsid) { m_sid = newsid; };
-    void ClearSID() { m_sid.clear(); m_sidUpdate = 0; };
-    void RenewSID() { m_sidUpdate = time(nullptr); };
-    bool IsActiveSID() { return !m_sid.empty() && time(nullptr) < m_sidUpdate + 3600; };
+    void SetSID(std::string newsid) { std::unique_lock<std::mutex> lock(m_mutexSID); m_sid = newsid; };
+    void ClearSID() { std::unique_lock<std::mutex> lock(m_mutexSID); m_sid.clear(); m_sidUpdate = 0; };
+    void RenewSID() { std::unique_lock<std::mutex> lock(m_mutexSID); m_sidUpdate = time(nullptr); };
+    bool IsActiveSID() { std::unique_lock<std::mutex> lock(m_mutexSID); return !m_sid.empty() && time(nullptr) < m_sidUpdate + 3600; };
 
   private:
     Request() = default;
@@ -59,9 +77,50 @@ namespace NextPVR
     Request(Request const&) = delete;
     void operator=(Request const&) = delete;
 
+    /*
+     * Holds one of the MAX_REQUESTS_IN_FLIGHT request slots for the life of an HTTP round trip.
+     * Streaming requests are granted slots ahead of queued foreground and background requests
+     * and background requests can never fill the whole pool.
+     */
+    class RequestSlot
+    {
+    public:
+      RequestSlot(Request& request, eRequestClass requestClass);
+      ~RequestSlot();
+    private:
+      bool CanStart() const;
+      Request& m_owner;
+      eRequestClass m_class;
+    };
+
+    /*
+     * Result of a read only request shared with callers who asked for the same resource while it was on the wire
+     */
+    struct SharedResponse
+    {
+      bool done = false;
+      int waiters = 0;
+      tinyxml2::XMLError result = tinyxml2::XML_ERROR_FILE_NOT_FOUND;
+      // parsed once by the leader, only read after done
+      tinyxml2::XMLDocument doc;
+    };
+
+    static std::string MethodName(const std::string& resource);
+    static eRequestClass ClassifyRequest(const std::string& resource);
+    static bool IsCoalesced(const std::string& resource);
+    tinyxml2::XMLError FetchMethodResponse(const std::string& resource, tinyxml2::XMLDocument& doc, bool compressed, std::string& response);
+    bool GetMethodURL(const std::string& resource, bool compressed, std::string& URL);
+    tinyxml2::XMLError CheckResponse(tinyxml2::XMLDocument& doc);
+
     Settings& m_settings = Settings::GetInstance();
-    mutable std::mutex m_mutexRequest;
-    time_t m_start = 0;
+    std::mutex m_mutexSlots;
+    std::condition_variable m_slotAvailable;
+    int m_activeRequests = 0;
+    int m_waitingRequests[BackgroundRequest + 1] = { 0 };
+    std::mutex m_mutexShared;
+    std::condition_variable m_sharedDone;
+    std::map<std::string, std::shared_ptr<SharedResponse>> m_sharedResponses;
+    mutable std::mutex m_mutexSID;
     std::string m_sid;
     time_t m_sidUpdate = 0;
   };
@@ -10,6 +10,7 @@
 #include "pvrclient-nextpvr.h"
 
 #include <kodi/tools/StringUtils.h>
+#include <algorithm>
 
 using namespace NextPVR;
 using namespace NextPVR::utilities;
@@ -19,39 +20,177 @@ using namespace NextPVR::utilities;
 int Channels::GetNumChannels()
 {
   // Kodi polls this while recordings are open avoid calls to backend
-  int channelCount = m_channelDetails.size();
+  int channelCount = GetChannelDetails()->size();
   if (channelCount == 0)
   {
-    tinyxml2::XMLDocument doc;
-    if (m_request.DoMethodRequest("channel.list", doc) == tinyxml2::XML_SUCCESS)
+    std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+    if (snapshot)
+      channelCount = snapshot->channels.size();
+  }
+  return channelCount;
+}
+
+std::shared_ptr<const ChannelSnapshot> Channels::GetSnapshot()
+{
+  // callers arriving during a load wait for it rather than start their own
+  std::unique_lock<std::mutex> lock(m_mutexSnapshot);
+  if (m_snapshotStale || !m_snapshot)
+  {
+    m_snapshotStale = false;
+    std::shared_ptr<ChannelSnapshot> snapshot = std::make_shared<ChannelSnapshot>();
+    if (LoadSnapshot(*snapshot))
+      m_snapshot = snapshot;
+    else
+      m_snapshotStale = true;
+  }
+  return m_snapshot;
+}
+
+bool Channels::LoadSnapshot(ChannelSnapshot& snapshot)
+{
+  tinyxml2::XMLDocument doc;
+  if (m_request.DoMethodRequest("channel.list&extras=true", doc) != tinyxml2::XML_SUCCESS)
+    return false;
+
+  tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
+  tinyxml2::XMLNode* pChannelNode;
+  for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
+  {
+    ChannelEntry channel;
+    channel.uid = XMLUtils::GetUIntValue(pChannelNode, "id");
+    channel.number = XMLUtils::GetUIntValue(pChannelNode, "number");
+    channel.minor = XMLUtils::GetUIntValue(pChannelNode, "minor");
+    XMLUtils::GetString(pChannelNode, "name", channel.name);
+
+    std::string buffer;
+    XMLUtils::GetString(pChannelNode, "type", buffer);
+    channel.radio = buffer == "0xa";
+
+    // icon download is needed when the tag is present
+    bool isIcon;
+    channel.icon = XMLUtils::GetBoolean(pChannelNode, "icon", isIcon);
+
+    // V5 has the EPG source type info.
+    std::string epg;
+    if (XMLUtils::GetString(pChannelNode, "epg", epg))
+      channel.epgNone = epg == "None";
+
+    buffer.clear();
+    if (XMLUtils::GetAdditiveString(pChannelNode->FirstChildElement("groups"), "group", "\t", buffer, true))
+      channel.groups = kodi::tools::StringUtils::Split(buffer, '\t');
+
+    snapshot.channels.emplace_back(std::move(channel));
+  }
+
+  doc.Clear();
+  if (m_request.DoMethodRequest("channel.groups", doc) == tinyxml2::XML_SUCCESS)
+  {
+    tinyxml2::XMLNode* groupsNode = doc.RootElement()->FirstChildElement("groups");
+    tinyxml2::XMLNode* pGroupNode;
+    std::string group;
+    for (pGroupNode = groupsNode->FirstChildElement("group"); pGroupNode; pGroupNode = pGroupNode->NextSiblingElement())
     {
-      tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-      tinyxml2::XMLNode* pChannelNode;
-      for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
-      {
-        channelCount++;
-      }
+      if (XMLUtils::GetString(pGroupNode, "name", group))
+        snapshot.groups.emplace_back(group);
     }
   }
-  return channelCount;
+  else
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "No Channel Group");
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "Loaded %d channels %d groups", snapshot.channels.size(), snapshot.groups.size());
+  return true;
 }
 
 std::string Channels::GetChannelIcon(int channelID)
 {
   std::string iconFilename = GetChannelIconFileName(channelID);
 
-  // do we already have the icon file?
-  if (kodi::vfs::FileExists(iconFilename))
+  // use what we have now, the download or a recheck of an old copy happens in the background
+  kodi::vfs::FileStatus status;
+  if (kodi::vfs::StatFile(iconFilename, status) && status.GetSize() > 0)
   {
+    if (time(nullptr) - status.GetModificationTime() > ICON_REVALIDATE_SECONDS)
+      QueueIcon(channelID, true);
     return iconFilename;
   }
-  const std::string URL = "/service?method=channel.icon&channel_id=" + std::to_string(channelID);
-  if (m_request.FileCopy(URL.c_str(), iconFilename) == HTTP_OK)
+  QueueIcon(channelID, false);
+  return "";
+}
+
+void Channels::QueueIcon(int channelID, bool revalidate)
+{
+  std::unique_lock<std::mutex> lock(m_mutexIcons);
+  // one attempt per channel per session, a failed download is not retried on every reload
+  if (!m_iconChecked.insert(channelID).second)
+    return;
+  m_iconQueue.emplace_back(channelID, revalidate);
+  if (m_iconWorkers >= ICON_WORKERS)
+    return;
+  if (m_iconWorkers == 0)
   {
-    return iconFilename;
+    for (std::thread& worker : m_iconThreads)
+    {
+      if (worker.joinable())
+        worker.join();
+    }
+    m_iconThreads.clear();
   }
+  m_iconRunning = true;
+  m_iconWorkers++;
+  m_iconThreads.emplace_back([this] { IconWorker(); });
+}
 
-  return "";
+void Channels::IconWorker()
+{
+  int fetched = 0;
+  bool trigger = false;
+  while (true)
+  {
+    std::pair<int, bool> entry;
+    {
+      // leave under the same lock QueueIcon uses so nothing queued now is left behind
+      std::unique_lock<std::mutex> lock(m_mutexIcons);
+      if (m_iconQueue.empty() || !m_iconRunning)
+      {
+        m_iconsChanged |= fetched > 0;
+        if (--m_iconWorkers == 0)
+        {
+          trigger = m_iconsChanged && m_iconRunning;
+          m_iconsChanged = false;
+        }
+        break;
+      }
+      entry = m_iconQueue.front();
+      m_iconQueue.pop_front();
+    }
+    const std::string iconFilename = GetChannelIconFileName(entry.first);
+    const std::string URL = "/service?method=channel.icon&channel_id=" + std::to_string(entry.first);
+    int64_t knownSize = -1;
+    kodi::vfs::FileStatus status;
+    if (entry.second && kodi::vfs::StatFile(iconFilename, status))
+      knownSize = static_cast<int64_t>(status.GetSize());
+    if (m_request.FileCopy(URL.c_str(), iconFilename, knownSize) == HTTP_OK)
+      fetched++;
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "Icon worker fetched %d icons", fetched);
+  if (trigger)
+    g_pvrclient->TriggerChannelUpdate();
+}
+
+void Channels::StopIconFetch()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutexIcons);
+    m_iconQueue.clear();
+    m_iconRunning = false;
+  }
+  for (std::thread& worker : m_iconThreads)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+  m_iconThreads.clear();
 }
 
 std::string Channels::GetChannelIconFileName(int channelID)
@@ -61,11 +200,19 @@ std::string Channels::GetChannelIconFileName(int channelID)
 
 void  Channels::DeleteChannelIcon(int channelID)
 {
+  {
+    std::unique_lock<std::mutex> lock(m_mutexIcons);
+    m_iconChecked.erase(channelID);
+  }
   kodi::vfs::DeleteFile(GetChannelIconFileName(channelID));
 }
 
 void Channels::DeleteChannelIcons()
 {
+  {
+    std::unique_lock<std::mutex> lock(m_mutexIcons);
+    m_iconChecked.clear();
+  }
   std::vector<kodi::vfs::CDirEntry> icons;
   if (kodi::vfs::GetDirectory("special://userdata/addon_data/pvr.nextpvr/", "nextpvr-ch*.png", icons))
   {
@@ -83,78 +230,136 @@ PVR_ERROR Channels::GetChannels(bool radio, kodi::addon::PVRChannelsResultSet& r
   if (radio && !m_settings.m_showRadio)
     return PVR_ERROR_NO_ERROR;
 
-  std::string stream;
-  std::map<int, std::pair<bool, bool>>::iterator  itr = m_channelDetails.begin();
-  while (itr != m_channelDetails.end())
-  {
-    if (itr->second.second == (radio == true))
-      itr = m_channelDetails.erase(itr);
-    else
-      ++itr;
-  }
-
-  tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest("channel.list&extras=true", doc) == tinyxml2::XML_SUCCESS)
+  ChannelDetails loaded;
+  std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+  if (snapshot)
   {
-    tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-    tinyxml2::XMLNode* pChannelNode;
-    for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
+    for (const ChannelEntry& channel : snapshot->channels)
     {
+      if (radio != channel.radio)
+        continue;
+
       kodi::addon::PVRChannel tag;
-      tag.SetUniqueId(XMLUtils::GetUIntValue(pChannelNode, "id"));
-      std::string buffer;
-      XMLUtils::GetString(pChannelNode, "type", buffer);
-      if ( buffer =="0xa")
+      tag.SetUniqueId(channel.uid);
+      tag.SetIsRadio(channel.radio);
+      tag.SetMimeType("application/octet-stream");
+      if (!channel.radio && IsChannelAPlugin(tag.GetUniqueId()))
       {
-        tag.SetIsRadio(true);
-        tag.SetMimeType("application/octet-stream");
+        std::string url;
+        GetLiveStream(tag.GetUniqueId(), url);
+        if (kodi::tools::StringUtils::EndsWithNoCase(url, ".m3u8"))
+          tag.SetMimeType("application/x-mpegURL");
+        else
+          tag.SetMimeType("video/MP2T");
       }
-      else
-      {
-        tag.SetIsRadio(false);
-        tag.SetMimeType("application/octet-stream");
-        if (IsChannelAPlugin(tag.GetUniqueId()))
-        {
-          if (kodi::tools::StringUtils::EndsWithNoCase(m_liveStreams[tag.GetUniqueId()], ".m3u8"))
-            tag.SetMimeType("application/x-mpegURL");
-          else
-            tag.SetMimeType("video/MP2T");
-        }
-      }
-      if (radio != tag.GetIsRadio())
-        continue;
 
-      tag.SetChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "number"));
-      tag.SetSubChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "minor"));
+      tag.SetChannelNumber(channel.number);
+      tag.SetSubChannelNumber(channel.minor);
+      tag.SetChannelName(channel.name);
 
-      buffer.clear();
-      XMLUtils::GetString(pChannelNode, "name", buffer);
-      tag.SetChannelName(buffer);
-
-      // check if we need to download a channel icon
-      bool isIcon;
-      if (XMLUtils::GetBoolean(pChannelNode, "icon", isIcon))
+      // missing icons are queued for download and show up when Kodi reloads the channels
+      if (channel.icon)
       {
-        // only set when true;
         std::string iconFile = GetChannelIcon(tag.GetUniqueId());
         if (iconFile.length() > 0)
           tag.SetIconPath(iconFile);
       }
 
-      // V5 has the EPG source type info.
-      std::string epg;
-      if (XMLUtils::GetString(pChannelNode, "epg", epg))
-        m_channelDetails[tag.GetUniqueId()] = std::make_pair(epg == "None", tag.GetIsRadio());
-      else
-        m_channelDetails[tag.GetUniqueId()] = std::make_pair(false, tag.GetIsRadio());
+      loaded.push_back({ static_cast<int>(channel.uid), channel.epgNone, channel.radio });
 
       // transfer channel to XBMC
       results.Add(tag);
     }
   }
+
+  // TV and radio loads can overlap, each keeps the other type from the latest published list
+  std::unique_lock<std::mutex> lock(m_mutexDetails);
+  std::shared_ptr<ChannelDetails> details = std::make_shared<ChannelDetails>(std::move(loaded));
+  for (const ChannelDetail& detail : *GetChannelDetails())
+  {
+    if (detail.radio != radio)
+      details->emplace_back(detail);
+  }
+  std::sort(details->begin(), details->end(), [](const ChannelDetail& a, const ChannelDetail& b) { return a.uid < b.uid; });
+  std::atomic_store(&m_channelDetails, std::shared_ptr<const ChannelDetails>(details));
   return PVR_ERROR_NO_ERROR;
 }
 
+int Channels::GetAdjacentChannel(int uid, int direction)
+{
+  // channel up and down in number order within the same TV or radio list, wrapping at the ends
+  std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+  if (!snapshot)
+    return 0;
+  auto current = std::find_if(snapshot->channels.begin(), snapshot->channels.end(), [uid](const ChannelEntry& channel) { return channel.uid == static_cast<unsigned int>(uid); });
+  if (current == snapshot->channels.end())
+    return 0;
+
+  std::vector<const ChannelEntry*> list;
+  for (const ChannelEntry& channel : snapshot->channels)
+  {
+    if (channel.radio == current->radio)
+      list.emplace_back(&channel);
+  }
+  std::sort(list.begin(), list.end(), [](const ChannelEntry* a, const ChannelEntry* b)
+  {
+    return a->number != b->number ? a->number < b->number : a->minor < b->minor;
+  });
+  const int count = static_cast<int>(list.size());
+  for (int i = 0; i < count; i++)
+  {
+    if (list[i]->uid == current->uid)
+      return static_cast<int>(list[(i + direction % count + count) % count]->uid);
+  }
+  return 0;
+}
+
+std::vector<int> Channels::GetGuideOrder()
+{
+  // channels in NextPVR groups come first in group order, then everything else with a guide
+  std::vector<int> order;
+  std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+  if (!snapshot)
+    return order;
+
+  std::unordered_set<unsigned int> added;
+  auto addChannel = [&](const ChannelEntry& channel)
+  {
+    if (channel.epgNone || (channel.radio && !m_settings.m_showRadio))
+      return;
+    if (added.insert(channel.uid).second)
+      order.emplace_back(channel.uid);
+  };
+  for (const std::string& group : snapshot->groups)
+  {
+    for (const ChannelEntry& channel : snapshot->channels)
+    {
+      if (std::find(channel.groups.begin(), channel.groups.end(), group) != channel.groups.end())
+        addChannel(channel);
+    }
+  }
+  for (const ChannelEntry& channel : snapshot->channels)
+    addChannel(channel);
+  return order;
+}
+
+bool Channels::GetChannelDetail(int uid, ChannelDetail& detail) const
+{
+  std::shared_ptr<const ChannelDetails> details = GetChannelDetails();
+  auto it = std::lower_bound(details->begin(), details->end(), uid, [](const ChannelDetail& a, int b) { return a.uid < b; });
+  if (it == details->end() || it->uid != uid)
+    return false;
+  detail = *it;
+  return true;
+}
+
+void Channels::ClearChannelDetails()
+{
+  std::unique_lock<std::mutex> lock(m_mutexDetails);
+  std::atomic_store(&m_channelDetails, std::make_shared<const ChannelDetails>());
+  std::atomic_store(&m_liveStreams, std::make_shared<const LiveStreams>());
+}
+
 /************************************************************/
 /** Channel group handling **/
 
@@ -168,7 +373,8 @@ PVR_ERROR Channels::GetChannelGroupsAmount(int& amount)
 PVR_RECORDING_CHANNEL_TYPE Channels::GetChannelType(unsigned int uid)
 {
   // when uid is invalid we assume TV because Kodi will
-  if (m_channelDetails.count(uid) > 0 && m_channelDetails[uid].second == true)
+  ChannelDetail detail;
+  if (GetChannelDetail(uid, detail) && detail.radio)
     return PVR_RECORDING_CHANNEL_TYPE_RADIO;
 
   return PVR_RECORDING_CHANNEL_TYPE_TV;
@@ -179,117 +385,129 @@ PVR_ERROR Channels::GetChannelGroups(bool radio, kodi::addon::PVRChannelGroupsRe
   if (radio && !m_settings.m_showRadio)
     return PVR_ERROR_NO_ERROR;
 
-  std::unordered_set selectedGroups = radio ? m_radioGroups : m_tvGroups;
+  std::unordered_set<std::string>& selectedGroups = radio ? m_radioGroups : m_tvGroups;
 
   selectedGroups.clear();
-  tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest("channel.list&extras=true", doc) == tinyxml2::XML_SUCCESS)
+  std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+  if (!snapshot)
+    return PVR_ERROR_NO_ERROR;
+
+  for (const ChannelEntry& channel : snapshot->channels)
   {
-    tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-    tinyxml2::XMLNode* pChannelNode;
-    for( pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode=pChannelNode->NextSiblingElement())
-    {
-      std::string buffer;
-      if (XMLUtils::GetAdditiveString(pChannelNode->FirstChildElement("groups"), "group", "\t", buffer, true))
-      {
-        std::vector<std::string> groups = kodi::tools::StringUtils::Split(buffer, '\t');
-        bool foundRadio = false;
-        buffer.clear();
-        XMLUtils::GetString(pChannelNode, "type", buffer);
-        if ( buffer == "0xa")
-        {
-          foundRadio = true;
-        }
-        if (radio == foundRadio)
-        {
-          for(auto const& group : groups)
-          {
-            if (selectedGroups.find(group) == selectedGroups.end())
-            {
-              selectedGroups.insert(group);
-            }
-          }
-        }
-      }
-    }
+    if (radio == channel.radio)
+      selectedGroups.insert(channel.groups.begin(), channel.groups.end());
   }
 
   // Many users won't have radio groups
   if (selectedGroups.size() == 0)
     return PVR_ERROR_NO_ERROR;
 
-  doc.Clear();
-  if (m_request.DoMethodRequest("channel.groups", doc) == tinyxml2::XML_SUCCESS)
+  int priority = 1;
+  for (const std::string& group : snapshot->groups)
   {
-    tinyxml2::XMLNode* groupsNode = doc.RootElement()->FirstChildElement("groups");
-    tinyxml2::XMLNode* pGroupNode;
-    std::string group;
-    int priority = 1;
-    for (pGroupNode = groupsNode->FirstChildElement("group"); pGroupNode; pGroupNode = pGroupNode->NextSiblingElement())
+    // "All Channels" won't match any group, skip empty NextPVR groups
+    if (selectedGroups.find(group) != selectedGroups.end())
     {
-      if (XMLUtils::GetString(pGroupNode, "name", group))
-      {
-        // "All Channels" won't match any group, skip empty NextPVR groups
-        if (selectedGroups.find(group) != selectedGroups.end())
-        {
-          kodi::addon::PVRChannelGroup tag;
-          tag.SetIsRadio(radio);
-          tag.SetPosition(priority++);
-          tag.SetGroupName(group);
-          results.Add(tag);
-        }
-      }
+      kodi::addon::PVRChannelGroup tag;
+      tag.SetIsRadio(radio);
+      tag.SetPosition(priority++);
+      tag.SetGroupName(group);
+      results.Add(tag);
     }
   }
-  else
-  {
-    kodi::Log(ADDON_LOG_DEBUG, "No Channel Group");
-  }
 
   return PVR_ERROR_NO_ERROR;
 }
 
 PVR_ERROR Channels::GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group, kodi::addon::PVRChannelGroupMembersResultSet& results)
 {
-  std::string encodedGroupName = UriEncode(group.GetGroupName());
-  std::string request = "channel.list&group_id=" + encodedGroupName;
-  tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest(request, doc) == tinyxml2::XML_SUCCESS)
+  std::shared_ptr<const ChannelSnapshot> snapshot = GetSnapshot();
+  if (!snapshot)
+    return PVR_ERROR_NO_ERROR;
+
+  std::shared_ptr<const GroupMembers> members = GetGroupMembers(snapshot, group.GetGroupName());
+  if (!members)
+    return PVR_ERROR_NO_ERROR;
+
+  for (const GroupMember& member : *members)
+  {
+    const unsigned int uid = member.uid;
+    auto channel = std::find_if(snapshot->channels.begin(), snapshot->channels.end(), [uid](const ChannelEntry& entry) { return entry.uid == uid; });
+    // ignore orphan channels in groups, radio and TV channels can share a group name
+    if (channel == snapshot->channels.end() || channel->radio != group.GetIsRadio())
+      continue;
+
+    kodi::addon::PVRChannelGroupMember tag;
+    tag.SetChannelUniqueId(uid);
+    tag.SetGroupName(group.GetGroupName());
+    tag.SetChannelNumber(member.number);
+    tag.SetSubChannelNumber(member.minor);
+    results.Add(tag);
+  }
+  return PVR_ERROR_NO_ERROR;
+}
+
+std::shared_ptr<const GroupMembers> Channels::GetGroupMembers(const std::shared_ptr<const ChannelSnapshot>& snapshot, const std::string& groupName)
+{
   {
-    tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
-    tinyxml2::XMLNode* pChannelNode;
-    for (pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode = pChannelNode->NextSiblingElement())
+    std::unique_lock<std::mutex> lock(m_mutexGroupMembers);
+    if (m_groupMembersSnapshot != snapshot)
     {
-      kodi::addon::PVRChannelGroupMember tag;
-      tag.SetChannelUniqueId(XMLUtils::GetUIntValue(pChannelNode, "id"));
-      // ignore orphan channels in groups
-      if (m_channelDetails.find(tag.GetChannelUniqueId()) != m_channelDetails.end()
-        && group.GetIsRadio() == m_channelDetails[tag.GetChannelUniqueId()].second)
-      {
-        tag.SetGroupName(group.GetGroupName());
-        tag.SetChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "number"));
-        tag.SetSubChannelNumber(XMLUtils::GetUIntValue(pChannelNode, "minor"));
-        results.Add(tag);
-      }
+      m_groupMembers.clear();
+      m_groupMembersSnapshot = snapshot;
     }
+    auto it = m_groupMembers.find(groupName);
+    if (it != m_groupMembers.end())
+      return it->second;
   }
-  return PVR_ERROR_NO_ERROR;
+
+  // the group's own numbering and order only come with the per group list
+  std::string request = "channel.list&group_id=" + UriEncode(groupName);
+  tinyxml2::XMLDocument doc;
+  if (m_request.DoMethodRequest(request, doc) != tinyxml2::XML_SUCCESS)
+    return nullptr;
+
+  std::shared_ptr<GroupMembers> members = std::make_shared<GroupMembers>();
+  tinyxml2::XMLNode* channelsNode = doc.RootElement()->FirstChildElement("channels");
+  tinyxml2::XMLNode* pChannelNode;
+  for (pChannelNode = channelsNode->FirstChildElement("channel"); pChannelNode; pChannelNode = pChannelNode->NextSiblingElement())
+  {
+    members->push_back(GroupMember{ XMLUtils::GetUIntValue(pChannelNode, "id"), XMLUtils::GetUIntValue(pChannelNode, "number"),
+                                    XMLUtils::GetUIntValue(pChannelNode, "minor") });
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutexGroupMembers);
+  // a reload while this was on the wire starts a new cache, the list is still right for the caller's snapshot
+  if (m_groupMembersSnapshot == snapshot)
+    m_groupMembers[groupName] = members;
+  return members;
 }
 
 bool Channels::IsChannelAPlugin(int uid)
 {
-  if (m_liveStreams.count(uid) != 0)
-    if (kodi::tools::StringUtils::StartsWith(m_liveStreams[uid], "plugin:") || kodi::tools::StringUtils::EndsWithNoCase(m_liveStreams[uid], ".m3u8"))
+  std::string url;
+  if (GetLiveStream(uid, url))
+    if (kodi::tools::StringUtils::StartsWith(url, "plugin:") || kodi::tools::StringUtils::EndsWithNoCase(url, ".m3u8"))
       return true;
 
   return false;
 }
 
+bool Channels::GetLiveStream(int uid, std::string& url) const
+{
+  std::shared_ptr<const LiveStreams> liveStreams = std::atomic_load(&m_liveStreams);
+  auto it = std::lower_bound(liveStreams->begin(), liveStreams->end(), uid, [](const std::pair<int, std::string>& a, int b) { return a.first < b; });
+  if (it == liveStreams->end() || it->first != uid)
+    return false;
+  url = it->second;
+  return true;
+}
+
 /************************************************************/
 void Channels::LoadLiveStreams()
 {
   const std::string URL = "/public/LiveStreams.xml";
-  m_liveStreams.clear();
+  std::map<int, std::string> streams;
   if (m_request.FileCopy(URL.c_str(), "special://userdata/addon_data/pvr.nextpvr/LiveStreams.xml") == HTTP_OK)
   {
     tinyxml2::XMLDocument doc;
@@ -310,7 +528,7 @@ void Channels::LoadLiveStreams()
             {
               int channelID = std::atoi(attrib);
               kodi::Log(ADDON_LOG_DEBUG, "%d %s", channelID, streamNode->FirstChild()->Value());
-              m_liveStreams[channelID] = streamNode->FirstChild()->Value();
+              streams[channelID] = streamNode->FirstChild()->Value();
             }
             catch (...)
             {
@@ -321,4 +539,6 @@ void Channels::LoadLiveStreams()
       }
     }
   }
+  // std::map iterates in uid order
+  std::atomic_store(&m_liveStreams, std::make_shared<const LiveStreams>(streams.begin(), streams.end()));
 }
@@ -10,10 +10,58 @@
 
 #include "BackendRequest.h"
 #include <kodi/addon-instance/PVR.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
 #include <unordered_set>
 
+#define ICON_WORKERS 3
+#define ICON_REVALIDATE_SECONDS (7 * 24 * 3600)
+
 namespace NextPVR
 {
+  /* one backend channel as reported by channel.list&extras=true */
+  struct ChannelEntry
+  {
+    unsigned int uid = 0;
+    unsigned int number = 0;
+    unsigned int minor = 0;
+    std::string name;
+    bool radio = false;
+    bool epgNone = false;
+    bool icon = false;
+    std::vector<std::string> groups;
+  };
+
+  /* what the rest of the addon needs to know about a channel Kodi has loaded */
+  struct ChannelDetail
+  {
+    int uid;
+    bool epgNone;
+    bool radio;
+  };
+
+  /* published lists are sorted by uid and replaced as a whole, never modified */
+  using ChannelDetails = std::vector<ChannelDetail>;
+  using LiveStreams = std::vector<std::pair<int, std::string>>;
+
+  /* one entry of a group's own channel list, numbered as in that group */
+  struct GroupMember
+  {
+    unsigned int uid;
+    unsigned int number;
+    unsigned int minor;
+  };
+  using GroupMembers = std::vector<GroupMember>;
+
+  /* channels, groups and memberships as of one load, never modified once published */
+  struct ChannelSnapshot
+  {
+    std::vector<ChannelEntry> channels;
+    std::vector<std::string> groups;
+  };
 
   class ATTR_DLL_LOCAL Channels
   {
@@ -38,12 +86,18 @@ namespace NextPVR
     PVR_ERROR GetChannelGroupMembers(const kodi::addon::PVRChannelGroup& group, kodi::addon::PVRChannelGroupMembersResultSet& results);
     bool IsChannelAPlugin(int uid);
     void LoadLiveStreams();
-    std::map<int, std::string> m_liveStreams;
+    bool GetLiveStream(int uid, std::string& url) const;
     std::string GetChannelIconFileName(int channelID);
     void DeleteChannelIcon(int channelID);
     void DeleteChannelIcons();
     PVR_RECORDING_CHANNEL_TYPE GetChannelType(unsigned int uid);
-    std::map<int, std::pair<bool, bool>> m_channelDetails;
+    void InvalidateSnapshot() { m_snapshotStale = true; };
+    std::vector<int> GetGuideOrder();
+    int GetAdjacentChannel(int uid, int direction);
+    std::shared_ptr<const ChannelDetails> GetChannelDetails() const { return std::atomic_load(&m_channelDetails); };
+    bool GetChannelDetail(int uid, ChannelDetail& detail) const;
+    void ClearChannelDetails();
+    void StopIconFetch();
     std::unordered_set<std::string> m_tvGroups;
     std::unordered_set<std::string> m_radioGroups;
 
@@ -54,6 +108,32 @@ namespace NextPVR
     void operator=(Channels const&) = delete;
 
     std::string GetChannelIcon(int channelID);
+    void QueueIcon(int channelID, bool revalidate);
+    void IconWorker();
+    std::shared_ptr<const ChannelSnapshot> GetSnapshot();
+    bool LoadSnapshot(ChannelSnapshot& snapshot);
+    std::shared_ptr<const GroupMembers> GetGroupMembers(const std::shared_ptr<const ChannelSnapshot>& snapshot, const std::string& groupName);
+
+    std::mutex m_mutexSnapshot;
+    std::shared_ptr<const ChannelSnapshot> m_snapshot;
+    std::atomic<bool> m_snapshotStale = { true };
+    // group lists are fetched once for each snapshot, the first time Kodi asks for the group
+    std::mutex m_mutexGroupMembers;
+    std::shared_ptr<const ChannelSnapshot> m_groupMembersSnapshot;
+    std::map<std::string, std::shared_ptr<const GroupMembers>> m_groupMembers;
+    // readers take a reference with std::atomic_load and are never blocked by a reload,
+    // m_mutexDetails only orders the writers
+    std::mutex m_mutexDetails;
+    std::shared_ptr<const ChannelDetails> m_channelDetails = std::make_shared<const ChannelDetails>();
+    std::shared_ptr<const LiveStreams> m_liveStreams = std::make_shared<const LiveStreams>();
+    // icons download in the background, Kodi is asked to reload channels once the queue drains
+    std::mutex m_mutexIcons;
+    std::deque<std::pair<int, bool>> m_iconQueue;
+    std::unordered_set<int> m_iconChecked;
+    std::vector<std::thread> m_iconThreads;
+    int m_iconWorkers = 0;
+    bool m_iconsChanged = false;
+    std::atomic<bool> m_iconRunning = { false };
     Settings& m_settings = Settings::GetInstance();
     Request& m_request = Request::GetInstance();
   };
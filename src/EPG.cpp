@@ -8,10 +8,11 @@
 #include "EPG.h"
 
 #include "pvrclient-nextpvr.h"
+#include "utilities/Scheduler.h"
 #include "utilities/XMLUtils.h"
 
 #include <kodi/tools/StringUtils.h>
-#include <regex>
+#include <cstring>
 
 using namespace NextPVR;
 using namespace NextPVR::utilities;
@@ -19,11 +20,46 @@ using namespace NextPVR::utilities;
 /************************************************************/
 /** EPG handling */
 
+namespace
+{
+  time_t TileStart(time_t when)
+  {
+    return when - when % EPG_TILE_SECONDS;
+  }
+
+  void HashCombine(size_t& hash, size_t value)
+  {
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  }
+
+  size_t HashBroadcast(const kodi::addon::PVREPGTag& broadcast)
+  {
+    // everything Kodi would show, a change in any of it means Kodi needs the listing again
+    size_t hash = 0;
+    std::hash<std::string> hashString;
+    HashCombine(hash, static_cast<size_t>(broadcast.GetStartTime()));
+    HashCombine(hash, static_cast<size_t>(broadcast.GetEndTime()));
+    HashCombine(hash, hashString(broadcast.GetTitle()));
+    HashCombine(hash, hashString(broadcast.GetEpisodeName()));
+    HashCombine(hash, hashString(broadcast.GetPlot()));
+    HashCombine(hash, hashString(broadcast.GetGenreDescription()));
+    HashCombine(hash, static_cast<size_t>(broadcast.GetGenreType()) << 8 | broadcast.GetGenreSubType());
+    HashCombine(hash, static_cast<size_t>(broadcast.GetSeriesNumber()) << 16 ^ broadcast.GetEpisodeNumber());
+    HashCombine(hash, broadcast.GetFlags());
+    HashCombine(hash, broadcast.GetStarRating());
+    HashCombine(hash, broadcast.GetYear());
+    HashCombine(hash, hashString(broadcast.GetFirstAired()));
+    HashCombine(hash, hashString(broadcast.GetCast()));
+    HashCombine(hash, hashString(broadcast.GetDirector()));
+    HashCombine(hash, hashString(broadcast.GetWriter()));
+    return hash;
+  }
+} // unnamed namespace
+
 PVR_ERROR EPG::GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::addon::PVREPGTagsResultSet& results)
 {
-  std::pair<bool, bool> channelDetail;
-  channelDetail = m_channels.m_channelDetails[channelUid];
-  if (channelDetail.first == true)
+  ChannelDetail channelDetail;
+  if (m_channels.GetChannelDetail(channelUid, channelDetail) && channelDetail.epgNone)
   {
     kodi::Log(ADDON_LOG_DEBUG, "Skipping %d", channelUid);
     return PVR_ERROR_NO_ERROR;
@@ -34,185 +70,579 @@ PVR_ERROR EPG::GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::
     kodi::Log(ADDON_LOG_DEBUG, "Skipping expired EPG data %d %ld %lld", channelUid, start, end);
     return PVR_ERROR_INVALID_PARAMETERS;
   }
+
+  // Kodi asks for the same window on every channel, warm the others while it works through them
+  StartPrefetch(start, end);
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    auto queued = std::find(m_prefetchQueue.begin(), m_prefetchQueue.end(), channelUid);
+    if (queued != m_prefetchQueue.end())
+      m_prefetchQueue.erase(queued);
+    m_prefetchDone.wait(lock, [this, channelUid] { return m_prefetching.count(channelUid) == 0; });
+  }
+
+  const time_t firstTile = TileStart(start);
+  const time_t lastTile = TileStart(end > start ? end - 1 : start);
+  LoadTiles(channelUid, firstTile, lastTile, ForegroundRequest);
+
+  // a listing lives in the tile it started in, the one before start can still be showing
+  std::set<unsigned int> added;
+  std::unique_lock<std::mutex> lock(m_mutexCache);
+  for (time_t tile = firstTile - EPG_TILE_SECONDS; tile <= lastTile; tile += EPG_TILE_SECONDS)
+  {
+    auto it = m_tiles.find(std::make_pair(channelUid, tile));
+    if (it == m_tiles.end())
+      continue;
+    for (const kodi::addon::PVREPGTag& broadcast : it->second.broadcasts)
+    {
+      if (broadcast.GetEndTime() > start && broadcast.GetStartTime() < end && added.insert(broadcast.GetUniqueBroadcastId()).second)
+        results.Add(broadcast);
+    }
+  }
+  return PVR_ERROR_NO_ERROR;
+}
+
+void EPG::LoadTiles(int channelUid, time_t firstTile, time_t lastTile, eRequestClass requestClass)
+{
+  // only fetch the runs of tiles we don't have or that went stale
+  std::vector<std::pair<time_t, time_t>> missing;
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    time_t runStart = 0;
+    for (time_t tile = firstTile; tile <= lastTile; tile += EPG_TILE_SECONDS)
+    {
+      auto it = m_tiles.find(std::make_pair(channelUid, tile));
+      const bool valid = it != m_tiles.end() && !it->second.stale;
+      if (!valid && runStart == 0)
+        runStart = tile;
+      else if (valid && runStart != 0)
+      {
+        missing.emplace_back(runStart, tile - EPG_TILE_SECONDS);
+        runStart = 0;
+      }
+    }
+    if (runStart != 0)
+      missing.emplace_back(runStart, lastTile);
+  }
+
+  for (const auto& run : missing)
+  {
+    std::vector<kodi::addon::PVREPGTag> broadcasts;
+    if (FetchListings(channelUid, run.first, run.second + EPG_TILE_SECONDS, requestClass, broadcasts))
+      StoreTiles(channelUid, run.first, run.second, broadcasts);
+  }
+}
+
+void EPG::StartPrefetch(time_t start, time_t end)
+{
+  if (m_settings.m_epgPrefetch <= 0 || m_prefetchStarted.exchange(true))
+    return;
+
+  // workers from before a reconnect leave as soon as they see the cleared queue
+  for (std::thread& worker : m_prefetchThreads)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+  m_prefetchThreads.clear();
+
+  const std::vector<int> order = m_channels.GetGuideOrder();
+  std::unique_lock<std::mutex> lock(m_mutexCache);
+  m_prefetchFirstTile = TileStart(start);
+  m_prefetchLastTile = TileStart(end > start ? end - 1 : start);
+  m_prefetchQueue.assign(order.begin(), order.end());
+  m_prefetchRunning = true;
+  kodi::Log(ADDON_LOG_DEBUG, "EPG prefetch %zu channels with %d workers", m_prefetchQueue.size(), m_settings.m_epgPrefetch);
+  for (int i = 0; i < m_settings.m_epgPrefetch; i++)
+    m_prefetchThreads.emplace_back([this] { PrefetchWorker(); });
+}
+
+void EPG::PrefetchWorker()
+{
+  while (m_prefetchRunning)
+  {
+    int channelUid;
+    time_t firstTile;
+    time_t lastTile;
+    {
+      std::unique_lock<std::mutex> lock(m_mutexCache);
+      if (m_prefetchQueue.empty())
+        break;
+      channelUid = m_prefetchQueue.front();
+      m_prefetchQueue.pop_front();
+      m_prefetching.insert(channelUid);
+      firstTile = m_prefetchFirstTile;
+      lastTile = m_prefetchLastTile;
+    }
+    // warming ahead of Kodi leaves the foreground slots to the calls it is waiting on
+    LoadTiles(channelUid, firstTile, lastTile, BackgroundRequest);
+    {
+      std::unique_lock<std::mutex> lock(m_mutexCache);
+      m_prefetching.erase(channelUid);
+    }
+    m_prefetchDone.notify_all();
+  }
+}
+
+bool EPG::FetchListings(int channelUid, time_t start, time_t end, eRequestClass requestClass, std::vector<kodi::addon::PVREPGTag>& broadcasts)
+{
   std::string request = kodi::tools::StringUtils::Format("channel.listings&channel_id=%d&start=%d&end=%d&genre=all", channelUid, static_cast<int>(start), static_cast<int>(end));
   if (m_settings.m_castcrew)
     request.append("&extras=true");
 
-  tinyxml2::XMLDocument doc;
+  // each listing is decoded as soon as it has been received
+  ListingDecoder decoder(*this, channelUid);
+  auto parseListing = [&](const tinyxml2::XMLElement* pListingNode)
+  {
+    broadcasts.emplace_back();
+    decoder.Decode(pListingNode, broadcasts.back());
+  };
+
+  return m_request.DoMethodRequest(request, requestClass, "l", parseListing) == tinyxml2::XML_SUCCESS;
+}
+
+namespace
+{
+  const char* const listingFields[] = { "name", "description", "subtitle", "year", "start", "end", "genre", "genre_type", "genre_sub_type",
+                                        "season", "episode", "original", "firstrun", "significance", "cast", "crew", "star_rating", "genres" };
 
-  if (m_request.DoMethodRequest(request, doc) == tinyxml2::XML_SUCCESS)
+  bool EqualsNoCase(const char* text, const char* lower)
   {
-    tinyxml2::XMLNode* listingsNode = doc.RootElement()->FirstChildElement("listings");
-    for (tinyxml2::XMLNode* pListingNode = listingsNode->FirstChildElement("l"); pListingNode; pListingNode = pListingNode->NextSiblingElement())
+    for (; *text && *lower; text++, lower++)
     {
-      kodi::addon::PVREPGTag broadcast;
-      std::string title;
-      std::string description;
-      std::string subtitle;
-      XMLUtils::GetString(pListingNode, "name", title);
-      XMLUtils::GetString(pListingNode, "description", description);
+      if (tolower(static_cast<unsigned char>(*text)) != *lower)
+        return false;
+    }
+    return *text == *lower;
+  }
 
-      if (XMLUtils::GetString(pListingNode, "subtitle", subtitle))
-      {
-        if (description != subtitle + ":" && kodi::tools::StringUtils::StartsWith(description, subtitle + ": "))
-        {
-          description = description.substr(subtitle.length() + 2);
-        }
-      }
+  time_t ParseSeconds(const char* ticks)
+  {
+    // backend times can carry milliseconds, only the first 10 digits are seconds
+    time_t value = 0;
+    for (int i = 0; i < 10 && isdigit(static_cast<unsigned char>(ticks[i])); i++)
+      value = value * 10 + (ticks[i] - '0');
+    return value;
+  }
+
+  bool SkipNumber(const char*& text)
+  {
+    // \d+[.]?\d*
+    if (!isdigit(static_cast<unsigned char>(*text)))
+      return false;
+    while (isdigit(static_cast<unsigned char>(*text)))
+      text++;
+    if (*text == '.')
+      text++;
+    while (isdigit(static_cast<unsigned char>(*text)))
+      text++;
+    return true;
+  }
+
+  bool ContainsText(const char* text, size_t length, const char* keyword)
+  {
+    const size_t keywordLength = strlen(keyword);
+    for (size_t pos = 0; pos + keywordLength <= length; pos++)
+    {
+      if (strncmp(text + pos, keyword, keywordLength) == 0)
+        return true;
+    }
+    return false;
+  }
+
+  void AppendToken(std::string& list, const char* value, size_t length)
+  {
+    if (!list.empty())
+      list.append(EPG_STRING_TOKEN_SEPARATOR);
+    list.append(value, length);
+  }
+} // unnamed namespace
 
-      broadcast.SetYear(XMLUtils::GetIntValue(pListingNode, "year"));
+EPG::ListingDecoder::ListingDecoder(EPG& epg, int channelUid) : m_epg(epg), m_channelUid(channelUid)
+{
+  // everything but the title is the same for every artwork URL in this response
+  m_artworkBase = m_epg.m_settings.m_urlBase;
+  m_artworkBase += "/service?method=channel.show.artwork";
+  if (m_epg.m_settings.m_sendSidWithMetadata)
+  {
+    m_artworkBase += "&sid=";
+    m_artworkBase += m_epg.m_request.GetSID();
+  }
+  m_artworkBase += "&name=";
+}
+
+int EPG::ListingDecoder::IntValue(eListingField field, int setDefault) const
+{
+  if (m_fields[field] == nullptr || *m_fields[field] == 0)
+    return setDefault;
+  return atoi(m_fields[field]);
+}
 
-      std::string startTime;
-      std::string endTime;
-      XMLUtils::GetString(pListingNode, "start", startTime);
-      startTime.resize(10);
-      XMLUtils::GetString(pListingNode, "end", endTime);
-      endTime.resize(10);
+void EPG::ListingDecoder::Decode(const tinyxml2::XMLElement* pListingNode, kodi::addon::PVREPGTag& broadcast)
+{
+  // one walk over the children, the first element of each name wins as it did with FirstChildElement
+  const tinyxml2::XMLElement* elements[FieldCount];
+  XMLUtils::GetChildElements(pListingNode, listingFields, FieldCount, elements);
+  for (int field = 0; field < FieldCount; field++)
+  {
+    m_fields[field] = nullptr;
+    if (elements[field])
+    {
+      const char* text = elements[field]->GetText();
+      m_fields[field] = text ? text : "";
+    }
+  }
 
-      const std::string oidLookup(endTime + ":" + std::to_string(channelUid));
+  const char* subtitle = Text(Subtitle);
+  const char* description = Text(Description);
+  const size_t subtitleLength = strlen(subtitle);
+  if (subtitleLength > 0 && strncmp(description, subtitle, subtitleLength) == 0 && description[subtitleLength] == ':' && description[subtitleLength + 1] == ' ')
+    description += subtitleLength + 2;
 
-      broadcast.SetTitle(title);
-      broadcast.SetEpisodeName(subtitle);
-      broadcast.SetUniqueChannelId(channelUid);
-      broadcast.SetStartTime(stol(startTime));
-      broadcast.SetUniqueBroadcastId(stoi(endTime));
-      broadcast.SetEndTime(stol(endTime));
-      broadcast.SetPlot(description);
+  const time_t endTime = ParseSeconds(Text(End));
+  m_text.assign(Text(Name));
+  broadcast.SetTitle(m_text);
+  m_subtitle.assign(subtitle);
+  broadcast.SetEpisodeName(m_subtitle);
+  broadcast.SetYear(IntValue(Year, 0));
+  broadcast.SetUniqueChannelId(m_channelUid);
+  broadcast.SetStartTime(ParseSeconds(Text(Start)));
+  broadcast.SetUniqueBroadcastId(static_cast<unsigned int>(endTime));
+  broadcast.SetEndTime(endTime);
 
-      std::string artworkPath;
-      if (m_settings.m_downloadGuideArtwork)
+  if (m_epg.m_settings.m_downloadGuideArtwork)
+  {
+    m_artwork = m_artworkBase;
+    {
+      // encoded titles are shared by every channel, series titles repeat all over the guide
+      std::unique_lock<std::mutex> lock(m_epg.m_mutexTitles);
+      auto it = m_epg.m_encodedTitles.find(m_text);
+      if (it == m_epg.m_encodedTitles.end())
       {
-        if (m_settings.m_sendSidWithMetadata)
-          artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings.m_urlBase, m_request.GetSID(), UriEncode(title).c_str());
-        else
-          artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&name=%s", m_settings.m_urlBase, UriEncode(title).c_str());
-        if (m_settings.m_guideArtPortrait)
-          artworkPath += "&prefer=poster";
-        broadcast.SetIconPath(artworkPath);
+        if (m_epg.m_encodedTitles.size() > 20000)
+          m_epg.m_encodedTitles.clear();
+        it = m_epg.m_encodedTitles.emplace(m_text, UriEncode(m_text)).first;
       }
-      std::string sGenre;
-      if (XMLUtils::GetString(pListingNode, "genre", sGenre))
+      m_artwork += it->second;
+    }
+    if (m_epg.m_settings.m_guideArtPortrait)
+      m_artwork += "&prefer=poster";
+    broadcast.SetIconPath(m_artwork);
+  }
+
+  m_text.assign(description);
+  broadcast.SetPlot(m_text);
+
+  if (*Text(Genre))
+  {
+    m_text.assign(Text(Genre));
+    broadcast.SetGenreDescription(m_text);
+    broadcast.SetGenreType(EPG_GENRE_USE_STRING);
+  }
+  else
+  {
+    // genre type
+    broadcast.SetGenreType(IntValue(GenreType, 0));
+    broadcast.SetGenreSubType(IntValue(GenreSubType, 0));
+  }
+  // a listing without <genres> must not keep the previous listing's
+  m_genres.clear();
+  if (elements[Genres])
+    DecodeGenres(elements[Genres]);
+  if (!m_genres.empty())
+  {
+    if (m_genres.find(EPG_STRING_TOKEN_SEPARATOR) != std::string::npos)
+    {
+      if (broadcast.GetGenreType() != EPG_GENRE_USE_STRING)
       {
-        broadcast.SetGenreDescription(sGenre);
-        broadcast.SetGenreType(EPG_GENRE_USE_STRING);
+        broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
       }
-      else
-      {
-        // genre type
-        broadcast.SetGenreType(XMLUtils::GetIntValue(pListingNode, "genre_type"));
-        broadcast.SetGenreSubType(XMLUtils::GetIntValue(pListingNode, "genre_sub_type"));
+      broadcast.SetGenreDescription(m_genres);
+    }
+    else if (m_epg.m_settings.m_genreString && broadcast.GetGenreSubType() != EPG_GENRE_USE_STRING)
+    {
+      broadcast.SetGenreDescription(m_genres);
+      broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
+    }
+  }
 
-      }
-      std::string allGenres;
-      if (XMLUtils::GetAdditiveString(pListingNode->FirstChildElement("genres"), "genre", EPG_STRING_TOKEN_SEPARATOR, allGenres, true))
-      {
-        if (allGenres.find(EPG_STRING_TOKEN_SEPARATOR) != std::string::npos)
-        {
-          if (broadcast.GetGenreType() != EPG_GENRE_USE_STRING)
-          {
-            broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
-          }
-          broadcast.SetGenreDescription(allGenres);
-        }
-        else if (m_settings.m_genreString && broadcast.GetGenreSubType() != EPG_GENRE_USE_STRING)
-        {
-          broadcast.SetGenreDescription(allGenres);
-          broadcast.SetGenreSubType(EPG_GENRE_USE_STRING);
-        }
+  broadcast.SetSeriesNumber(IntValue(Season, EPG_TAG_INVALID_SERIES_EPISODE));
+  broadcast.SetEpisodeNumber(IntValue(Episode, EPG_TAG_INVALID_SERIES_EPISODE));
+  broadcast.SetEpisodePartNumber(EPG_TAG_INVALID_SERIES_EPISODE);
 
-      }
-      broadcast.SetSeriesNumber(XMLUtils::GetIntValue(pListingNode, "season", EPG_TAG_INVALID_SERIES_EPISODE));
-      broadcast.SetEpisodeNumber(XMLUtils::GetIntValue(pListingNode, "episode", EPG_TAG_INVALID_SERIES_EPISODE));
-      broadcast.SetEpisodePartNumber(EPG_TAG_INVALID_SERIES_EPISODE);
+  m_text.assign(Text(Original));
+  broadcast.SetFirstAired(m_text);
 
-      std::string original;
-      XMLUtils::GetString(pListingNode, "original", original);
-      broadcast.SetFirstAired(original);
+  const char* firstrun = Text(FirstRun);
+  if (EqualsNoCase(firstrun, "true") || EqualsNoCase(firstrun, "yes") || EqualsNoCase(firstrun, "on") || EqualsNoCase(firstrun, "enabled"))
+  {
+    const char* significance = Text(Significance);
+    if (strcmp(significance, "Live") == 0)
+    {
+      broadcast.SetFlags(EPG_TAG_FLAG_IS_LIVE);
+    }
+    else if (strstr(significance, "Premiere") != nullptr)
+    {
+      broadcast.SetFlags(EPG_TAG_FLAG_IS_PREMIERE);
+    }
+    else if (strstr(significance, "Finale") != nullptr)
+    {
+      broadcast.SetFlags(EPG_TAG_FLAG_IS_FINALE);
+    }
+    else if (m_epg.m_settings.m_showNew)
+    {
+      broadcast.SetFlags(EPG_TAG_FLAG_IS_NEW);
+    }
+  }
 
-      bool firstrun;
-      if (XMLUtils::GetBoolean(pListingNode, "firstrun", firstrun))
+  if (m_epg.m_settings.m_castcrew)
+  {
+    DecodeCast(Text(Cast));
+    broadcast.SetCast(m_cast);
+    DecodeCrew(Text(Crew));
+    broadcast.SetDirector(m_director);
+    broadcast.SetWriter(m_writer);
+  }
+
+  int starRating;
+  if (DecodeStarRating(Text(StarRating), starRating))
+    broadcast.SetStarRating(starRating);
+}
+
+void EPG::ListingDecoder::DecodeGenres(const tinyxml2::XMLElement* pGenresNode)
+{
+  // same result as XMLUtils::GetAdditiveString including clear="true"
+  m_genres.clear();
+  for (const tinyxml2::XMLElement* genre = pGenresNode->FirstChildElement("genre"); genre; genre = genre->NextSiblingElement("genre"))
+  {
+    const char* text = genre->GetText();
+    if (text == nullptr || *text == 0)
+      continue;
+    const char* clear = genre->Attribute("clear");
+    if (clear && EqualsNoCase(clear, "true"))
+      m_genres.clear();
+    AppendToken(m_genres, text, strlen(text));
+  }
+}
+
+void EPG::ListingDecoder::DecodeCast(const char* cast)
+{
+  // "Actor:A;Host:B" becomes "A,B"
+  m_cast.clear();
+  while (*cast)
+  {
+    if (strncmp(cast, "Actor:", 6) == 0)
+      cast += 6;
+    else if (strncmp(cast, "Host:", 5) == 0)
+      cast += 5;
+    else
+    {
+      m_cast.push_back(*cast == ';' ? ',' : *cast);
+      cast++;
+    }
+  }
+}
+
+void EPG::ListingDecoder::DecodeCrew(const char* crew)
+{
+  // "Role:Name" entries separated by ';', anything without exactly one ':' is ignored
+  m_writer.clear();
+  m_director.clear();
+  while (*crew)
+  {
+    const char* end = strchr(crew, ';');
+    if (end == nullptr)
+      end = crew + strlen(crew);
+    const char* colon = static_cast<const char*>(memchr(crew, ':', end - crew));
+    if (colon != nullptr && memchr(colon + 1, ':', end - colon - 1) == nullptr)
+    {
+      const size_t roleLength = colon - crew;
+      const char* name = colon + 1;
+      const size_t nameLength = end - name;
+      if (ContainsText(crew, roleLength, "Writer") || ContainsText(crew, roleLength, "Screenwriter"))
+        AppendToken(m_writer, name, nameLength);
+      if (roleLength == 8 && strncmp(crew, "Director", 8) == 0)
+        AppendToken(m_director, name, nameLength);
+    }
+    crew = *end ? end + 1 : end;
+  }
+}
+
+bool EPG::ListingDecoder::DecodeStarRating(const char* rating, int& starRating)
+{
+  // "3.5" or "7/10", a single value is out of 4
+  const char* text = rating;
+  if (!SkipNumber(text))
+    return false;
+  const double quotient = atof(rating);
+  double denominator = 0;
+  if (*text == '/')
+  {
+    const char* denominatorText = ++text;
+    if (!SkipNumber(text))
+      return false;
+    denominator = atof(denominatorText);
+  }
+  if (*text != 0)
+    return false;
+  if (denominator == 0)
+    denominator = 4;
+  starRating = (quotient / denominator * 10.0) + 0.5;
+  return true;
+}
+
+bool EPG::StoreTiles(int channelUid, time_t firstTile, time_t lastTile, const std::vector<kodi::addon::PVREPGTag>& broadcasts)
+{
+  // listings that started before the fetched range go in its first tile
+  std::map<time_t, EpgTile> fetched;
+  for (time_t tile = firstTile; tile <= lastTile; tile += EPG_TILE_SECONDS)
+    fetched[tile].hash = std::hash<time_t>()(tile);
+  for (const kodi::addon::PVREPGTag& broadcast : broadcasts)
+  {
+    const time_t tile = std::min(std::max(TileStart(broadcast.GetStartTime()), firstTile), lastTile);
+    EpgTile& fetchedTile = fetched[tile];
+    fetchedTile.broadcasts.emplace_back(broadcast);
+    HashCombine(fetchedTile.hash, HashBroadcast(broadcast));
+  }
+
+  bool changed = false;
+  std::unique_lock<std::mutex> lock(m_mutexCache);
+  for (auto& tile : fetched)
+  {
+    EpgTile& cached = m_tiles[std::make_pair(channelUid, tile.first)];
+    if (cached.hash != tile.second.hash)
+      changed = true;
+    cached = std::move(tile.second);
+  }
+
+  // Kodi doesn't ask for anything older than a day
+  const time_t expired = TileStart(time(nullptr) - 24 * 3600) - EPG_TILE_SECONDS;
+  auto it = m_tiles.lower_bound(std::make_pair(channelUid, static_cast<time_t>(0)));
+  while (it != m_tiles.end() && it->first.first == channelUid && it->first.second < expired)
+    it = m_tiles.erase(it);
+
+  return changed;
+}
+
+int EPG::UpdateGuide()
+{
+  // channels Kodi has loaded through us are checked in the background, the rest are refetched by Kodi
+  std::vector<int> triggers;
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    const time_t now = time(nullptr);
+    for (const ChannelDetail& channel : *m_channels.GetChannelDetails())
+    {
+      if (channel.epgNone)
+        continue;
+      bool cached = false;
+      auto it = m_tiles.lower_bound(std::make_pair(channel.uid, static_cast<time_t>(0)));
+      for (; it != m_tiles.end() && it->first.first == channel.uid; ++it)
       {
-        if (firstrun)
-        {
-          std::string significance;
-          XMLUtils::GetString(pListingNode, "significance", significance);
-          if (significance == "Live")
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_LIVE);
-          }
-          else if (significance.find("Premiere") != std::string::npos)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_PREMIERE);
-          }
-          else if (significance.find("Finale") != std::string::npos)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_FINALE);
-          }
-          else if (m_settings.m_showNew)
-          {
-            broadcast.SetFlags(EPG_TAG_FLAG_IS_NEW);
-          }
-        }
+        cached = true;
+        // the past doesn't change
+        if (it->first.second + EPG_TILE_SECONDS > now)
+          it->second.stale = true;
       }
-      if (m_settings.m_castcrew)
+      if (cached)
       {
-        std::string castcrew;
-        XMLUtils::GetString(pListingNode, "cast", castcrew);
-        std::replace(castcrew.begin(), castcrew.end(), ';', ',');
-        kodi::tools::StringUtils::Replace(castcrew, "Actor:", "");
-        kodi::tools::StringUtils::Replace(castcrew, "Host:", "");
-        broadcast.SetCast(castcrew);
-
-        castcrew.clear();
-        XMLUtils::GetString(pListingNode, "crew", castcrew);
-        std::vector<std::string> allcrew = kodi::tools::StringUtils::Split(castcrew, ";", 0);
-        std::string writer;
-        std::string director;
-        for (auto it = allcrew.begin(); it != allcrew.end(); ++it)
-        {
-          std::vector<std::string> onecrew = kodi::tools::StringUtils::Split(*it, ":", 0);
-          if (onecrew.size() == 2)
-          {
-            if (kodi::tools::StringUtils::ContainsKeyword(onecrew[0].c_str(), { "Writer", "Screenwriter" }))
-            {
-              if (!writer.empty())
-                writer.append(EPG_STRING_TOKEN_SEPARATOR);
-              writer.append(onecrew[1]);
-            }
-            if (onecrew[0] == "Director")
-            {
-              if (!director.empty())
-                director.append(EPG_STRING_TOKEN_SEPARATOR);
-              director.append(onecrew[1]);
-            }
-          }
-        }
-        broadcast.SetDirector(director);
-        broadcast.SetWriter(writer);
+        if (std::find(m_refreshQueue.begin(), m_refreshQueue.end(), channel.uid) == m_refreshQueue.end())
+          m_refreshQueue.emplace_back(channel.uid);
       }
-      std::string rating;
-      if (XMLUtils::GetString(pListingNode, "star_rating", rating))
+      else
       {
-        std::regex base_regex("(\\d+[.]?\\d*)(?:(?:/)(\\d+[.]?\\d*))?");
-        std::smatch base_match;
-        if (std::regex_match(rating, base_match, base_regex))
-        {
-          if (base_match.size() == 3)
-          {
-            double quotient = std::atof(base_match[1].str().c_str());
-            double denominator = std::atof(base_match[2].str().c_str());
-            // if single value passed assume base 4
-            if (denominator == 0)
-              denominator = 4;
-            int starRating = (quotient / denominator * 10.0) + 0.5;
-            broadcast.SetStarRating(starRating);
-          }
-        }
+        triggers.emplace_back(channel.uid);
       }
-      results.Add(broadcast);
     }
-    return PVR_ERROR_NO_ERROR;
+
+    if (!m_refreshQueue.empty() && !m_refreshRunning)
+    {
+      m_refreshRunning = true;
+      m_refreshChecked = 0;
+      m_refreshChanged = 0;
+      m_refreshTask = Scheduler::GetInstance().Schedule(std::chrono::milliseconds(0), [this] { return RefreshTask(); });
+    }
   }
 
-  return PVR_ERROR_NO_ERROR;
+  for (int channelUid : triggers)
+    g_pvrclient->TriggerEpgUpdate(channelUid);
+  return triggers.size();
+}
+
+bool EPG::RefreshChannel(int channelUid)
+{
+  std::vector<std::pair<time_t, time_t>> stale;
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    auto it = m_tiles.lower_bound(std::make_pair(channelUid, static_cast<time_t>(0)));
+    for (; it != m_tiles.end() && it->first.first == channelUid; ++it)
+    {
+      if (!it->second.stale)
+        continue;
+      if (!stale.empty() && stale.back().second + EPG_TILE_SECONDS == it->first.second)
+        stale.back().second = it->first.second;
+      else
+        stale.emplace_back(it->first.second, it->first.second);
+    }
+  }
+
+  bool changed = false;
+  for (const auto& run : stale)
+  {
+    std::vector<kodi::addon::PVREPGTag> broadcasts;
+    if (FetchListings(channelUid, run.first, run.second + EPG_TILE_SECONDS, BackgroundRequest, broadcasts))
+      changed |= StoreTiles(channelUid, run.first, run.second, broadcasts);
+  }
+  return changed;
+}
+
+std::chrono::milliseconds EPG::RefreshTask()
+{
+  // one channel per run so the connection and change checks get a turn in between
+  int channelUid;
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    if (m_refreshQueue.empty() || !m_refreshRunning)
+    {
+      m_refreshRunning = false;
+      kodi::Log(ADDON_LOG_DEBUG, "EPG refresh checked %d channels, %d changed", m_refreshChecked, m_refreshChanged);
+      return Scheduler::Done;
+    }
+    channelUid = m_refreshQueue.front();
+    m_refreshQueue.erase(m_refreshQueue.begin());
+  }
+  m_refreshChecked++;
+  if (RefreshChannel(channelUid))
+  {
+    m_refreshChanged++;
+    g_pvrclient->TriggerEpgUpdate(channelUid);
+  }
+  return std::chrono::milliseconds(0);
+}
+
+void EPG::ClearCache()
+{
+  std::unique_lock<std::mutex> lock(m_mutexCache);
+  m_tiles.clear();
+  m_prefetchQueue.clear();
+  m_prefetchStarted = false;
+}
+
+void EPG::StopRefresh()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutexCache);
+    m_refreshQueue.clear();
+    m_refreshRunning = false;
+    m_prefetchQueue.clear();
+    m_prefetchRunning = false;
+  }
+  Scheduler::GetInstance().Cancel(m_refreshTask);
+  m_refreshTask = 0;
+  for (std::thread& worker : m_prefetchThreads)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+  m_prefetchThreads.clear();
 }
@@ -12,6 +12,19 @@
 #include <kodi/addon-instance/PVR.h>
 #include "Channels.h"
 #include "Recordings.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* listings are cached per channel in fixed, epoch aligned slices of this many seconds */
+#define EPG_TILE_SECONDS (6 * 3600)
 
 namespace NextPVR
 {
@@ -27,12 +40,82 @@ namespace NextPVR
       return epg;
     }
     PVR_ERROR GetEPGForChannel(int channelUid, time_t start, time_t end, kodi::addon::PVREPGTagsResultSet& results);
+    int UpdateGuide();
+    void ClearCache();
+    void StopRefresh();
 
   private:
     EPG() = default;
     EPG(EPG const&) = delete;
     void operator=(EPG const&) = delete;
 
+    /* listings of one channel starting inside one tile */
+    struct EpgTile
+    {
+      std::vector<kodi::addon::PVREPGTag> broadcasts;
+      size_t hash = 0;
+      bool stale = false;
+    };
+
+    /* single pass decoder for <l> elements, keeps its buffers from one listing to the next */
+    class ListingDecoder
+    {
+    public:
+      ListingDecoder(EPG& epg, int channelUid);
+      void Decode(const tinyxml2::XMLElement* pListingNode, kodi::addon::PVREPGTag& broadcast);
+
+    private:
+      enum eListingField
+      {
+        Name, Description, Subtitle, Year, Start, End, Genre, GenreType, GenreSubType,
+        Season, Episode, Original, FirstRun, Significance, Cast, Crew, StarRating, Genres, FieldCount
+      };
+      const char* Text(eListingField field) const { return m_fields[field] ? m_fields[field] : ""; }
+      int IntValue(eListingField field, int setDefault) const;
+      void DecodeGenres(const tinyxml2::XMLElement* pGenresNode);
+      void DecodeCast(const char* cast);
+      void DecodeCrew(const char* crew);
+      static bool DecodeStarRating(const char* rating, int& starRating);
+
+      EPG& m_epg;
+      const int m_channelUid;
+      const char* m_fields[FieldCount];
+      std::string m_artworkBase;
+      std::string m_text;
+      std::string m_subtitle;
+      std::string m_genres;
+      std::string m_cast;
+      std::string m_writer;
+      std::string m_director;
+      std::string m_artwork;
+    };
+
+    bool FetchListings(int channelUid, time_t start, time_t end, eRequestClass requestClass, std::vector<kodi::addon::PVREPGTag>& broadcasts);
+    bool StoreTiles(int channelUid, time_t firstTile, time_t lastTile, const std::vector<kodi::addon::PVREPGTag>& broadcasts);
+    void LoadTiles(int channelUid, time_t firstTile, time_t lastTile, eRequestClass requestClass);
+    void StartPrefetch(time_t start, time_t end);
+    void PrefetchWorker();
+    bool RefreshChannel(int channelUid);
+    std::chrono::milliseconds RefreshTask();
+
+    std::mutex m_mutexCache;
+    std::map<std::pair<int, time_t>, EpgTile> m_tiles;
+    std::vector<int> m_refreshQueue;
+    uint64_t m_refreshTask = 0;
+    std::atomic<bool> m_refreshRunning = { false };
+    int m_refreshChecked = 0;
+    int m_refreshChanged = 0;
+    std::deque<int> m_prefetchQueue;
+    std::set<int> m_prefetching;
+    std::condition_variable m_prefetchDone;
+    std::vector<std::thread> m_prefetchThreads;
+    std::atomic<bool> m_prefetchStarted = { false };
+    std::atomic<bool> m_prefetchRunning = { false };
+    time_t m_prefetchFirstTile = 0;
+    time_t m_prefetchLastTile = 0;
+    std::mutex m_mutexTitles;
+    std::unordered_map<std::string, std::string> m_encodedTitles;
+
     Settings& m_settings = Settings::GetInstance();
     Request& m_request = Request::GetInstance();
     Recordings& m_recordings = Recordings::GetInstance();
@@ -17,14 +17,17 @@ PVR_ERROR MenuHook::CallSettingsMenuHook(const kodi::addon::PVRMenuhook& menuhoo
   if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_DELETE_ALL_CHANNNEL_ICONS)
   {
     m_channels.DeleteChannelIcons();
+    m_channels.InvalidateSnapshot();
     g_pvrclient->TriggerChannelUpdate();
   }
   else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_UPDATE_CHANNNELS)
   {
+    m_channels.InvalidateSnapshot();
     g_pvrclient->TriggerChannelUpdate();
   }
   else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_UPDATE_CHANNNEL_GROUPS)
   {
+    m_channels.InvalidateSnapshot();
     g_pvrclient->TriggerChannelGroupsUpdate();
   }
   else if (menuhook.GetHookId() == PVR_MENUHOOK_SETTING_SEND_WOL)
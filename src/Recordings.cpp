@@ -13,6 +13,7 @@
 
 #include <regex>
 #include <unordered_set>
+#include <vector>
 
 #include <kodi/tools/StringUtils.h>
 
@@ -33,20 +34,9 @@ PVR_ERROR Recordings::GetRecordingsAmount(bool deleted, int& amount)
     return PVR_ERROR_NO_ERROR;
   }
 
-  tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest("recording.list&filter=ready", doc) == tinyxml2::XML_SUCCESS)
-  {
-    tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-    if (recordingsNode != nullptr)
-    {
-      tinyxml2::XMLNode* pRecordingNode;
-      m_iRecordingCount = 0;
-      for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-      {
-        m_iRecordingCount++;
-      }
-    }
-  }
+  int recordingCount = 0;
+  if (m_request.DoMethodRequest("recording.list&filter=ready", "recording", [&recordingCount](const tinyxml2::XMLElement*) { recordingCount++; }) == tinyxml2::XML_SUCCESS)
+    m_iRecordingCount = recordingCount;
   amount = m_iRecordingCount;
   return PVR_ERROR_NO_ERROR;
 }
@@ -141,14 +131,28 @@ PVR_ERROR Recordings::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResu
       }
     }
   }
-  if (m_request.DoMethodRequest("recording.list&filter=all", doc) == tinyxml2::XML_SUCCESS)
-  {
-    tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-    tinyxml2::XMLNode* pRecordingNode;
-    std::map<std::string, int> names;
-    std::map<std::string, int> seasons;
-    if (m_settings.m_flattenRecording || m_settings.m_separateSeasons)
+  std::map<std::string, int> names;
+  std::map<std::string, int> seasons;
+  // only passed to Kodi once the whole list arrived, a failed or cut off one adds nothing
+  std::vector<kodi::addon::PVRRecording> recordings;
+  auto addRecording = [&](const tinyxml2::XMLNode* pRecordingNode)
+  {
+    kodi::addon::PVRRecording tag;
+    std::string title;
+    XMLUtils::GetString(pRecordingNode, "name", title);
+    if (UpdatePvrRecording(pRecordingNode, tag, title, names[title] == 1, seasons[title] == std::numeric_limits<int>::max()))
+      recordings.emplace_back(tag);
+  };
+
+  tinyxml2::XMLError listResult;
+  if (m_settings.m_flattenRecording || m_settings.m_separateSeasons)
+  {
+    // titles and seasons have to be counted before the first recording can be added
+    listResult = m_request.DoMethodRequest("recording.list&filter=all", doc);
+    if (listResult == tinyxml2::XML_SUCCESS)
     {
+      tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
+      tinyxml2::XMLNode* pRecordingNode;
       kodi::addon::PVRRecording mytag;
       int season;
       for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
@@ -180,17 +184,21 @@ PVR_ERROR Recordings::GetRecordings(bool deleted, kodi::addon::PVRRecordingsResu
           seasons[title] = season;
         }
       }
+      for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
+        addRecording(pRecordingNode);
     }
-    for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
+  }
+  else
+  {
+    listResult = m_request.DoMethodRequest("recording.list&filter=all", "recording", addRecording);
+  }
+
+  if (listResult == tinyxml2::XML_SUCCESS)
+  {
+    for (const auto& tag : recordings)
     {
-      kodi::addon::PVRRecording tag;
-      std::string title;
-      XMLUtils::GetString(pRecordingNode, "name", title);
-      if (UpdatePvrRecording(pRecordingNode, tag, title, names[title] == 1, seasons[title] == std::numeric_limits<int>::max()))
-      {
-        recordingCount++;
-        results.Add(tag);
-      }
+      recordingCount++;
+      results.Add(tag);
     }
     m_iRecordingCount = recordingCount;
     // force read disk space
@@ -213,12 +221,13 @@ PVR_ERROR Recordings::GetRecordingsLastPlayedPosition()
   // include already-completed recordings
   PVR_ERROR returnValue = PVR_ERROR_NO_ERROR;
   tinyxml2::XMLDocument doc;
-  if (m_request.DoMethodRequest("recording.list&filter=ready", doc) == tinyxml2::XML_SUCCESS)
+  std::map<int, int> lastPlayed;
+  auto addPosition = [&lastPlayed](const tinyxml2::XMLElement* pRecordingNode)
   {
-    m_lastPlayed.clear();
-    for (const tinyxml2::XMLNode*  pRecordingNode = doc.RootElement()->FirstChildElement("recordings")->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-      m_lastPlayed[XMLUtils::GetIntValue(pRecordingNode, "id")] =  XMLUtils::GetIntValue(pRecordingNode, "playback_position");
-  }
+    lastPlayed[XMLUtils::GetIntValue(pRecordingNode, "id")] = XMLUtils::GetIntValue(pRecordingNode, "playback_position");
+  };
+  if (m_request.DoMethodRequest("recording.list&filter=ready", "recording", addPosition) == tinyxml2::XML_SUCCESS)
+    m_lastPlayed.swap(lastPlayed);
   return returnValue;
 }
 
@@ -426,7 +435,7 @@ bool Recordings::UpdatePvrRecording(const tinyxml2::XMLNode* pRecordingNode, kod
         name = UriEncode(title);
 
     if (m_settings.m_sendSidWithMetadata)
-      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings.m_urlBase, m_request.GetSID(), name.c_str());
+      artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&sid=%s&name=%s", m_settings.m_urlBase, m_request.GetSID().c_str(), name.c_str());
     else
       artworkPath = kodi::tools::StringUtils::Format("%s/service?method=channel.show.artwork&name=%s", m_settings.m_urlBase, name.c_str());
     tag.SetFanartPath(artworkPath);
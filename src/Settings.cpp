@@ -64,10 +64,18 @@ void Settings::ReadFromAddon()
 
   m_prebuffer5 = kodi::addon::GetSettingInt("prebuffer5", 0);
 
+  m_readAhead = kodi::addon::GetSettingInt("readahead", 8);
+
+  m_warmStandby = kodi::addon::GetSettingBoolean("warmstandby", false);
+
+  m_localTimeshiftSize = kodi::addon::GetSettingInt("localtimeshiftsize", 2048);
+
   m_liveChunkSize = kodi::addon::GetSettingInt("chunklivetv", 64);
 
   m_chunkRecording = kodi::addon::GetSettingInt("chunkrecording", 32);
 
+  m_chunkAuto = kodi::addon::GetSettingBoolean("chunkauto", false);
+
   m_ignorePadding = kodi::addon::GetSettingBoolean("ignorepadding", true);
 
   m_resolution = kodi::addon::GetSettingString("resolution",  "720");
@@ -99,6 +107,8 @@ void Settings::ReadFromAddon()
 
   m_castcrew = kodi::addon::GetSettingBoolean("castcrew", false);
 
+  m_epgPrefetch = kodi::addon::GetSettingInt("epgprefetch", 2);
+
 
   /* Log the current settings for debugging purposes */
   kodi::Log(ADDON_LOG_DEBUG, "settings: host='%s', port=%i, mac=%4.4s...", m_hostname.c_str(), m_port, m_hostMACAddress.c_str());
@@ -225,6 +235,8 @@ ADDON_STATUS Settings::SetValue(const std::string& settingName, const kodi::addo
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_guideArtPortrait, ADDON_STATUS_NEED_SETTINGS, ADDON_STATUS_OK);
   else if (settingName == "castcrew")
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_castcrew, ADDON_STATUS_NEED_RESTART, ADDON_STATUS_OK);
+  else if (settingName == "epgprefetch")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_epgPrefetch, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "recordingsize")
     return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_showRecordingSize, ADDON_STATUS_NEED_SETTINGS, ADDON_STATUS_OK);
   else if (settingName == "diskspace")
@@ -245,10 +257,18 @@ ADDON_STATUS Settings::SetValue(const std::string& settingName, const kodi::addo
     return SetEnumSetting<eStreamingMethod, ADDON_STATUS>(settingName, settingValue, m_liveStreamingMethod, ADDON_STATUS_NEED_RESTART, ADDON_STATUS_OK);
   else if (settingName == "prebuffer5")
     return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_prebuffer5, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "readahead")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_readAhead, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "warmstandby")
+    return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_warmStandby, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "localtimeshiftsize")
+    return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_localTimeshiftSize, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "chucksize")
     return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_liveChunkSize, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "chuckrecordings")
     return SetSetting<int, ADDON_STATUS>(settingName, settingValue, m_chunkRecording, ADDON_STATUS_OK, ADDON_STATUS_OK);
+  else if (settingName == "chunkauto")
+    return SetSetting<bool, ADDON_STATUS>(settingName, settingValue, m_chunkAuto, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "resolution")
     return SetStringSetting<ADDON_STATUS>(settingName, settingValue, m_resolution, ADDON_STATUS_OK, ADDON_STATUS_OK);
   else if (settingName == "ffmpegdirect")
@@ -20,7 +20,9 @@ namespace NextPVR
   {
     RealTime = 2,
     Transcoded = 3,
-    ClientTimeshift = 4
+    ClientTimeshift = 4,
+    BlockTimeshift = 5,
+    LocalTimeshift = 6
   };
 
   enum eGuideArt
@@ -93,6 +95,7 @@ namespace NextPVR
     bool m_guideArtPortrait = false;
     bool m_genreString = false;
     bool m_castcrew = false;
+    int m_epgPrefetch = 2;
 
     //Recordings
     bool m_showRecordingSize = false;
@@ -112,7 +115,11 @@ namespace NextPVR
     int m_timeshiftBufferSeconds = 1200;
     eStreamingMethod m_liveStreamingMethod = RealTime;
     int m_liveChunkSize = 64;
+    bool m_chunkAuto = false;
     int m_prebuffer5 = 0;
+    int m_readAhead = 8;
+    bool m_warmStandby = false;
+    int m_localTimeshiftSize = 2048;
     std::string m_resolution = "720";
     bool m_transcodedTimeshift = false;
 
@@ -12,6 +12,7 @@
 #include <kodi/General.h>
 #include <kodi/tools/StringUtils.h>
 #include <string>
+#include <vector>
 
 using namespace NextPVR;
 using namespace NextPVR::utilities;
@@ -42,19 +43,10 @@ PVR_ERROR Timers::GetTimersAmount(int& amount)
     }
   }
   // get list of pending recordings
-  doc.Clear();
-  if (m_request.DoMethodRequest("recording.list&filter=pending", doc) == tinyxml2::XML_SUCCESS)
-  {
-    tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-    if (recordingsNode != nullptr)
-    {
-      tinyxml2::XMLNode* pRecordingNode;
-      for (pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-      {
-        timerCount++;
-      }
-    }
-  }
+  int pendingCount = 0;
+  // a failed or cut off list counts for nothing, as before streaming
+  if (m_request.DoMethodRequest("recording.list&filter=pending", "recording", [&pendingCount](const tinyxml2::XMLElement*) { pendingCount++; }) == tinyxml2::XML_SUCCESS)
+    timerCount += pendingCount;
   if (timerCount > -1)
   {
     // to do why?
@@ -82,11 +74,12 @@ PVR_ERROR Timers::GetTimers(kodi::addon::PVRTimersResultSet& results)
 
       tag.SetClientIndex(XMLUtils::GetUIntValue(pRecurringNode, "id"));
       int channelUID = XMLUtils::GetIntValue(pRulesNode, "ChannelOID");
+      ChannelDetail channelDetail;
       if (channelUID == 0)
       {
         tag.SetClientChannelUid(PVR_TIMER_ANY_CHANNEL);
       }
-      else if (m_channels.m_channelDetails.find(channelUID) == m_channels.m_channelDetails.end())
+      else if (!m_channels.GetChannelDetail(channelUID, channelDetail))
       {
         kodi::Log(ADDON_LOG_DEBUG, "Invalid channel uid %d", channelUID);
         tag.SetClientChannelUid(PVR_CHANNEL_INVALID_UID);
@@ -216,35 +209,46 @@ PVR_ERROR Timers::GetTimers(kodi::addon::PVRTimersResultSet& results)
       results.Add(tag);
     }
     // next add the one-off recordings.
+    // timers are only passed on once a whole list arrived, a failed or cut off one adds nothing
     bool isRecordingUpdated = false;
-    doc.Clear();
-    if (m_request.DoMethodRequest("recording.list&filter=pending", doc) == tinyxml2::XML_SUCCESS)
+    std::vector<kodi::addon::PVRTimer> timers;
+    auto addTimer = [&](const tinyxml2::XMLElement* pRecordingNode)
     {
-      tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-      for (tinyxml2::XMLNode* pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
+      kodi::addon::PVRTimer tag;
+      UpdatePvrTimer(pRecordingNode, tag);
+      timers.emplace_back(tag);
+    };
+    if (m_request.DoMethodRequest("recording.list&filter=pending", "recording", addTimer) == tinyxml2::XML_SUCCESS)
+    {
+      time_t nextStart = 0;
+      for (const auto& tag : timers)
       {
-        kodi::addon::PVRTimer tag;
-        UpdatePvrTimer(pRecordingNode, tag);
         // pass timer to xbmc
         timerCount++;
         if (tag.GetState() == PVR_TIMER_STATE_RECORDING)
           isRecordingUpdated = true;
+        else if (tag.GetState() == PVR_TIMER_STATE_SCHEDULED)
+        {
+          const time_t start = tag.GetStartTime() - tag.GetMarginStart() * 60;
+          if (nextStart == 0 || start < nextStart)
+            nextStart = start;
+        }
         results.Add(tag);
       }
+      m_nextTimerStart = nextStart;
+      g_pvrclient->ExpectStandbyDeadline();
     }
-    doc.Clear();
-    if (m_request.DoMethodRequest("recording.list&filter=conflict", doc) == tinyxml2::XML_SUCCESS)
+
+    timers.clear();
+    if (m_request.DoMethodRequest("recording.list&filter=conflict", "recording", addTimer) == tinyxml2::XML_SUCCESS)
     {
-     tinyxml2::XMLNode* recordingsNode = doc.RootElement()->FirstChildElement("recordings");
-     for (tinyxml2::XMLNode* pRecordingNode = recordingsNode->FirstChildElement("recording"); pRecordingNode; pRecordingNode = pRecordingNode->NextSiblingElement())
-     {
-       kodi::addon::PVRTimer tag;
-       UpdatePvrTimer(pRecordingNode, tag);
-       // pass timer to xbmc
-       timerCount++;
-       results.Add(tag);
-     }
-     m_iTimerCount = timerCount;
+      for (const auto& tag : timers)
+      {
+        // pass timer to xbmc
+        timerCount++;
+        results.Add(tag);
+      }
+      m_iTimerCount = timerCount;
     }
 
     if (isRecordingUpdated) {
@@ -262,7 +266,7 @@ PVR_ERROR Timers::GetTimers(kodi::addon::PVRTimersResultSet& results)
   return returnValue;
 }
 
-bool Timers::UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag)
+bool Timers::UpdatePvrTimer(const tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag)
 {
   tag.SetTimerType(pRecordingNode->FirstChildElement("epg_event_oid") ? TIMER_ONCE_EPG : TIMER_ONCE_MANUAL);
   tag.SetClientIndex(XMLUtils::GetUIntValue(pRecordingNode, "id"));
@@ -12,6 +12,7 @@
 #include "Channels.h"
 #include <kodi/addon-instance/PVR.h>
 #include <algorithm>
+#include <atomic>
 
 namespace NextPVR
 {
@@ -77,9 +78,14 @@ namespace NextPVR
     PVR_ERROR AddTimer(const kodi::addon::PVRTimer& timer);
     PVR_ERROR DeleteTimer(const kodi::addon::PVRTimer& timer, bool forceDelete);
     PVR_ERROR UpdateTimer(const kodi::addon::PVRTimer& timer);
-    bool UpdatePvrTimer(tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag);
+    bool UpdatePvrTimer(const tinyxml2::XMLNode* pRecordingNode, kodi::addon::PVRTimer& tag);
     time_t m_lastTimerUpdateTime = 0;
 
+    /* \brief Earliest pending recording start, pre padding included, as of the last timer list.
+       \return 0 when nothing is scheduled
+    */
+    time_t NextTimerStart() const { return m_nextTimerStart; }
+
   private:
     Timers() = default;
 
@@ -93,6 +99,7 @@ namespace NextPVR
     int m_defaultLimit = NEXTPVR_LIMIT_ASMANY;
     int m_defaultShowType = NEXTPVR_SHOWTYPE_ANY;
     int m_iTimerCount = -1;
+    std::atomic<time_t> m_nextTimerStart = {0};
 
     std::string GetDayString(int dayMask);
 
@@ -0,0 +1,287 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "BlockTimeshift.h"
+#include <algorithm>
+
+using namespace timeshift;
+
+void BlockTimeShift::StartProducer()
+{
+  // blocks come over their own connections, the handle Open made is not needed
+  CloseHandle(m_inputHandle);
+
+  std::unique_lock<std::mutex> lock(m_blockMutex);
+  const int64_t start = m_readPosition - m_readPosition % BLOCK_SIZE;
+  m_sd.inputBlockSize = BLOCK_SIZE;
+  m_sd.requestBlock = start;
+  m_sd.lastBlockBuffered = start - BLOCK_SIZE;
+  m_sd.streamPosition = start;
+  m_sd.lastKnownLength = m_stream_length.load();
+  m_sd.requestNumber = 0;
+  m_sd.currentWindowSize = 0;
+
+  // room for the request window plus the block kept behind the reader
+  int size = std::max(m_settings.m_readAhead * 1024 * 1024, (BLOCK_WINDOW + 2) * BLOCK_SIZE);
+  size -= size % BLOCK_SIZE;
+  if (!m_cirBuf || m_cirBuf->Size() != size)
+    m_cirBuf.reset(new CircularBuffer(size));
+  m_cirBuf->Reset();
+  m_seeker.reset(new Seeker(&m_sd, m_cirBuf.get()));
+  if (m_readPosition != start)
+  {
+    m_seeker->InitSeek(m_readPosition, SEEK_SET);
+    m_seeker->ProcessRequests();
+  }
+
+  m_completed.clear();
+  m_inFlight.clear();
+  m_retry.clear();
+  m_generation++;
+  m_inputEnded = false;
+  m_producerRunning = true;
+  for (int i = 0; i < BLOCK_CONNECTIONS; i++)
+    m_fetchThreads.emplace_back([this] { FetchWorker(); });
+}
+
+void BlockTimeShift::StopProducer()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_blockMutex);
+    m_producerRunning = false;
+  }
+  m_blockSpace.notify_all();
+  m_blockData.notify_all();
+  for (std::thread& fetcher : m_fetchThreads)
+  {
+    if (fetcher.joinable())
+      fetcher.join();
+  }
+  m_fetchThreads.clear();
+  kodi::Log(ADDON_LOG_DEBUG, "BlockTimeShift %d block requests", m_sd.requestNumber);
+}
+
+bool BlockTimeShift::GetStreamInfo()
+{
+  // the lease thread and the fetchers at the live point both ask
+  std::unique_lock<std::mutex> infoLock(m_infoMutex);
+  const bool ok = ClientTimeShift::GetStreamInfo();
+  m_sd.lastKnownLength = m_stream_length.load();
+  m_blockSpace.notify_all();
+  return ok;
+}
+
+void BlockTimeShift::UpdateWindow()
+{
+  m_sd.currentWindowSize = static_cast<int>(m_inFlight.size() + m_completed.size() + m_retry.size());
+}
+
+bool BlockTimeShift::NextBlock(int64_t& block, int64_t& length)
+{
+  const int64_t known = m_sd.lastKnownLength;
+  if (!m_retry.empty())
+  {
+    block = *m_retry.begin();
+    m_retry.erase(m_retry.begin());
+  }
+  else
+  {
+    block = m_sd.requestBlock;
+    if (m_sd.currentWindowSize >= BLOCK_WINDOW)
+      return false;
+    // everything between the reader and this block has to fit in the circular buffer
+    if (block + BLOCK_SIZE - m_sd.streamPosition > m_cirBuf->Size() - BLOCK_SIZE)
+      return false;
+    // only whole blocks until the backend says the stream is finished
+    if (block + BLOCK_SIZE > known && !(m_complete && block < known))
+      return false;
+    m_sd.requestBlock += BLOCK_SIZE;
+  }
+  length = m_complete ? std::min(static_cast<int64_t>(BLOCK_SIZE), known - block) : BLOCK_SIZE;
+  m_inFlight.insert(block);
+  m_sd.requestNumber++;
+  UpdateWindow();
+  return true;
+}
+
+void BlockTimeShift::FetchWorker()
+{
+  while (m_producerRunning)
+  {
+    int64_t block;
+    int64_t length;
+    int generation;
+    {
+      std::unique_lock<std::mutex> lock(m_blockMutex);
+      if (!NextBlock(block, length))
+      {
+        if (m_complete && m_sd.requestBlock >= m_sd.lastKnownLength && m_sd.currentWindowSize == 0)
+        {
+          m_inputEnded = true;
+          m_blockData.notify_all();
+        }
+        const bool liveEdge = m_sd.requestBlock + BLOCK_SIZE > m_sd.lastKnownLength;
+        if (liveEdge && !m_complete && !m_refreshing && m_lastRefresh != time(nullptr))
+        {
+          // the backend has not written the next block yet, ask how far it has got
+          m_refreshing = true;
+          lock.unlock();
+          GetStreamInfo();
+          lock.lock();
+          m_refreshing = false;
+          m_lastRefresh = time(nullptr);
+          continue;
+        }
+        m_blockSpace.wait_for(lock, std::chrono::milliseconds(200));
+        continue;
+      }
+      generation = m_generation;
+    }
+
+    std::vector<byte> data;
+    const bool fetched = FetchBlock(block, length, data);
+
+    std::unique_lock<std::mutex> lock(m_blockMutex);
+    if (generation != m_generation)
+      continue;
+    m_inFlight.erase(block);
+    if (!fetched)
+    {
+      m_retry.insert(block);
+      UpdateWindow();
+      lock.unlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      continue;
+    }
+    m_completed.emplace(block, std::move(data));
+    FlushBlocks();
+  }
+}
+
+bool BlockTimeShift::FetchBlock(int64_t block, int64_t length, std::vector<byte>& data)
+{
+  const std::string range = m_sourceURL + std::to_string(block) + "-" + std::to_string(block + length - 1) + "|connection-timeout=" + std::to_string(m_readTimeout);
+  kodi::vfs::CFile input;
+  if (!input.OpenFile(range, ADDON_READ_NO_CACHE))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "%s:%d: could not open block %lld", __FUNCTION__, __LINE__, block);
+    return false;
+  }
+  data.resize(static_cast<size_t>(length));
+  int64_t received = 0;
+  while (received < length && m_producerRunning)
+  {
+    const ssize_t dataLen = input.Read(data.data() + received, static_cast<size_t>(length - received));
+    if (dataLen <= 0)
+      break;
+    received += dataLen;
+  }
+  input.Close();
+  if (received != length)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: block %lld short %lld of %lld", __FUNCTION__, __LINE__, block, received, length);
+    return false;
+  }
+  return true;
+}
+
+void BlockTimeShift::FlushBlocks()
+{
+  while (true)
+  {
+    const int64_t next = m_sd.lastBlockBuffered + BLOCK_SIZE;
+    auto it = m_completed.find(next);
+    if (it == m_completed.end())
+      break;
+    if (m_seeker->Active() && next < m_seeker->SeekStreamOffset())
+    {
+      // requested before a seek jumped past it
+      m_sd.lastBlockBuffered = next;
+      m_completed.erase(it);
+      continue;
+    }
+    // keep a block free so the one just read survives a short seek back
+    if (m_cirBuf->BytesFree() < static_cast<int>(it->second.size()) + BLOCK_SIZE)
+      break;
+    m_cirBuf->WriteBytes(it->second.data(), static_cast<int>(it->second.size()));
+    m_tsIndex.Scan(it->second.data(), it->second.size(), next);
+    m_sd.lastBlockBuffered = next;
+    m_sd.lastBufferTime = time(nullptr);
+    m_completed.erase(it);
+    if (m_seeker->Active())
+      m_seeker->PostprocessSeek(next);
+    m_blockData.notify_all();
+  }
+  UpdateWindow();
+}
+
+ssize_t BlockTimeShift::Read(byte *buffer, size_t length)
+{
+  std::unique_lock<std::mutex> lock(m_blockMutex);
+  if (!m_cirBuf)
+    return -1;
+  if (m_cirBuf->BytesAvailable() == 0 && !m_inputEnded)
+  {
+    m_underruns++;
+    if (!m_blockData.wait_for(lock, std::chrono::seconds(m_readTimeout), [&] { return m_cirBuf->BytesAvailable() > 0 || m_inputEnded || !m_producerRunning; }))
+      kodi::Log(ADDON_LOG_DEBUG, "%s:%d: no block after %d seconds", __FUNCTION__, __LINE__, m_readTimeout);
+  }
+  const int dataLen = m_cirBuf->ReadBytes(buffer, std::min(static_cast<int>(length), m_cirBuf->BytesAvailable()));
+  m_sd.streamPosition.fetch_add(dataLen);
+  m_readPosition = m_sd.streamPosition.load();
+  if (dataLen > 0)
+    LogZapTime();
+  FlushBlocks();
+  m_blockSpace.notify_all();
+  return dataLen;
+}
+
+int64_t BlockTimeShift::Seek(int64_t position, int whence)
+{
+  if (m_complete) return -1;
+  std::unique_lock<std::mutex> lock(m_blockMutex);
+  if (!m_seeker)
+    return -1;
+
+  if (whence == SEEK_CUR)
+    position += m_sd.streamPosition;
+  else if (whence == SEEK_END)
+    position += m_sd.lastKnownLength;
+  position = std::max(position, SlipBufferStart());
+  position = std::min(position, m_sd.lastKnownLength.load());
+  if (m_isPaused)
+    m_streamPosition = position;
+
+  m_seeker->InitSeek(position, SEEK_SET);
+  if (m_seeker->PreprocessSeek())
+  {
+    // outside the window, drop everything and restart the fetchers at the target block
+    m_generation++;
+    m_completed.clear();
+    m_inFlight.clear();
+    m_retry.clear();
+    m_seeker->ProcessRequests();
+    m_sd.lastBlockBuffered = m_sd.requestBlock - BLOCK_SIZE;
+    m_inputEnded = false;
+  }
+  else if (!m_seeker->BlockRequested())
+  {
+    // served from the circular buffer
+    m_seeker->Clear();
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %d window %d", __FUNCTION__, __LINE__, position, whence, m_sd.currentWindowSize);
+  m_readPosition = position;
+  FlushBlocks();
+  m_blockSpace.notify_all();
+  return position;
+}
+
+int64_t BlockTimeShift::BufferedBytes() const
+{
+  std::unique_lock<std::mutex> lock(m_blockMutex);
+  return m_cirBuf ? m_cirBuf->BytesAvailable() : 0;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "ClientTimeshift.h"
+#include "CircularBuffer.h"
+#include "Seeker.h"
+#include "session.h"
+#include <map>
+#include <set>
+
+#define BLOCK_SIZE (256 * 1024)
+#define BLOCK_WINDOW 8
+#define BLOCK_CONNECTIONS 4
+
+namespace timeshift {
+
+  /**
+   * Client timeshift that reads the backend rolling file as fixed size
+   * blocks over several connections at once, each a &seek=start-end range.
+   * Blocks go into the circular buffer in stream order and Seeker decides
+   * when a seek can be served from the window without reconnecting.
+   */
+  class ATTR_DLL_LOCAL BlockTimeShift : public ClientTimeShift
+  {
+  public:
+    BlockTimeShift() : ClientTimeShift()
+    {
+      kodi::Log(ADDON_LOG_INFO, "BlockTimeShift Buffer created!");
+    }
+
+    virtual ~BlockTimeShift() { StopLease(); StopProducer(); }
+
+    virtual ssize_t Read(byte *buffer, size_t length) override;
+    int64_t Seek(int64_t position, int whence) override;
+    virtual bool GetStreamInfo() override;
+
+    virtual int64_t BufferedBytes() const override;
+
+  protected:
+    virtual void StartProducer() override;
+    virtual void StopProducer() override;
+
+  private:
+    void FetchWorker();
+    bool NextBlock(int64_t& block, int64_t& length);
+    bool FetchBlock(int64_t block, int64_t length, std::vector<byte>& data);
+    void FlushBlocks();
+    void UpdateWindow();
+
+    session_data_t m_sd = {};
+    std::unique_ptr<CircularBuffer> m_cirBuf;
+    std::unique_ptr<Seeker> m_seeker;
+
+    mutable std::mutex m_blockMutex;
+    std::mutex m_infoMutex;
+    std::condition_variable m_blockData;
+    std::condition_variable m_blockSpace;
+    std::vector<std::thread> m_fetchThreads;
+    // fetched but not yet in the circular buffer, and requested but not yet fetched
+    std::map<int64_t, std::vector<byte>> m_completed;
+    std::set<int64_t> m_inFlight;
+    std::set<int64_t> m_retry;
+    // bumped on every reconnecting seek, fetches from an older generation are dropped
+    int m_generation = 0;
+    bool m_refreshing = false;
+    time_t m_lastRefresh = 0;
+  };
+}
@@ -7,11 +7,14 @@
  */
 
 #include "Buffer.h"
+#include "../utilities/Scheduler.h"
 #include <kodi/General.h>
+#include <algorithm>
 
 #include <sstream>
 
 using namespace timeshift;
+using namespace NextPVR::utilities;
 
 const int Buffer::DEFAULT_READ_TIMEOUT = 10;
 
@@ -45,6 +48,7 @@ bool Buffer::Open(const std::string inputUrl, int optFlag)
 
 Buffer::~Buffer()
 {
+  StopLease();
   Buffer::Close();
 }
 
@@ -63,39 +67,55 @@ void Buffer::CloseHandle(kodi::vfs::CFile& handle)
   }
 }
 
-void Buffer::LeaseWorker(void)
+void Buffer::StartLease()
 {
-  while (m_isLeaseRunning == true)
+  StopLease();
+  m_leaseTask = Scheduler::GetLeaseInstance().Schedule(std::chrono::milliseconds(0), [this]()
   {
-    time_t now = time(nullptr);
-    bool complete = false;
-    if ( m_nextLease <= now  && m_complete == false)
+    return LeaseTask();
+  });
+}
+
+void Buffer::StopLease()
+{
+  Scheduler::GetLeaseInstance().Cancel(m_leaseTask);
+  m_leaseTask = 0;
+}
+
+std::chrono::milliseconds Buffer::LeaseTask()
+{
+  time_t now = time(nullptr);
+  bool complete = false;
+  if ( m_nextLease <= now  && m_complete == false)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    enum LeaseStatus retval = Buffer::Lease();
+    if ( retval == Leased)
+    {
+      m_nextLease = now + 7;
+    }
+    else if (retval == LeaseClosed)
     {
-      std::this_thread::yield();
-      std::unique_lock<std::mutex> lock(m_mutex);
-      enum LeaseStatus retval = Buffer::Lease();
-      if ( retval == Leased)
-      {
-        m_nextLease = now + 7;
-      }
-      else if (retval == LeaseClosed)
-      {
-        complete = true;
-        kodi::QueueNotification(QUEUE_ERROR, kodi::addon::GetLocalizedString(30190), kodi::addon::GetLocalizedString(30053));
-      }
-      else
-      {
-        kodi::Log(ADDON_LOG_ERROR, "channel.transcode.lease failed %lld", m_nextLease );
-        m_nextLease = now + 1;
-      }
+      complete = true;
+      kodi::QueueNotification(QUEUE_ERROR, kodi::addon::GetLocalizedString(30190), kodi::addon::GetLocalizedString(30053));
     }
-    if (m_nextStreamInfo <= now || m_nextRoll <= now || complete == true)
+    else
     {
-      GetStreamInfo();
-      if (complete) m_complete = true;
+      kodi::Log(ADDON_LOG_ERROR, "channel.transcode.lease failed %lld", m_nextLease );
+      m_nextLease = now + 1;
     }
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
   }
+  if (m_nextStreamInfo <= now || m_nextRoll <= now || complete == true)
+  {
+    GetStreamInfo();
+    if (complete) m_complete = true;
+  }
+  // sleep until whichever is due first, looking again at least every 10 seconds
+  now = time(nullptr);
+  time_t next = std::min(m_nextStreamInfo, m_nextRoll);
+  if (m_complete == false)
+    next = std::min(next, m_nextLease);
+  return std::chrono::seconds(std::min(std::max(next - now, static_cast<time_t>(1)), static_cast<time_t>(10)));
 }
 
 enum LeaseStatus Buffer::Lease()
@@ -14,6 +14,7 @@
   #include <Synchapi.h>
 #endif
 #include <string>
+#include <chrono>
 #include <ctime>
 #include <atomic>
 #include "../Settings.h"
@@ -170,9 +171,11 @@ namespace timeshift {
     time_t m_nextRoll;
     time_t m_nextLease;
     time_t m_nextStreamInfo;
-    bool m_isLeaseRunning;
-    std::thread m_leaseThread;
-    void LeaseWorker();
+    // lease and stream info refresh, run by the scheduler while the stream is open
+    uint64_t m_leaseTask = 0;
+    void StartLease();
+    void StopLease();
+    std::chrono::milliseconds LeaseTask();
     virtual bool GetStreamInfo() {return true;}
     bool m_complete;
     mutable std::mutex m_mutex;
@@ -37,7 +37,6 @@ bool CircularBuffer::WriteBytes(const byte *buffer, int length)
   if (m_iWritePos == m_iSize)
     m_iWritePos = 0;
   m_iBytes += length;
-  kodi::Log(ADDON_LOG_DEBUG, "WriteBytes: wrote %d bytes, returning true. [%d] [%d] [%d]", length, m_iSize, m_iBytes, m_iSize - m_iBytes);
   return true;
 }
 
@@ -58,7 +57,6 @@ int  CircularBuffer::ReadBytes(byte *buffer, int length)
   if (m_iReadPos == m_iSize)
     m_iReadPos = 0;
   m_iBytes -= length;
-  kodi::Log(ADDON_LOG_DEBUG, "ReadBytes: returning %d\n", length);
   return length;
 }
 
@@ -26,8 +26,11 @@ bool ClientTimeShift::Open(const std::string inputUrl)
   m_rollingStartSeconds = 0;
   m_bytesPerSecond = 0;
   m_complete = false;
+  m_tsIndex.Reset();
 
   m_prebuffer = m_settings.m_prebuffer5;
+  m_zapStart = std::chrono::steady_clock::now();
+  m_zapLogged = false;
 
   if (m_channel_id != 0)
   {
@@ -43,36 +46,33 @@ bool ClientTimeShift::Open(const std::string inputUrl)
     return false;
   }
 
-  time_t timeout = 20;
-
+  // poll quickly while the tuner starts, backing off to once a second
+  const auto deadline = m_zapStart + std::chrono::seconds(20);
+  auto leaseAt = m_zapStart + std::chrono::seconds(10);
+  int pollMs = 50;
+  bool started = false;
   do {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-    timeout--;
-    if ( ClientTimeShift::GetStreamInfo())
+    std::this_thread::sleep_for(std::chrono::milliseconds(pollMs));
+    pollMs = std::min(pollMs * 2, 1000);
+    if (ClientTimeShift::GetStreamInfo())
     {
-      if  (m_stream_length > 50000)
-      {
-        break;
-      }
+      // enough for the demuxer to probe, plus the pre-buffer seconds when asked for
+      started = m_stream_length > 50000 && m_stream_duration >= m_prebuffer;
     }
-    if (timeout == 10)
+    if (std::chrono::steady_clock::now() >= leaseAt)
+    {
       Lease();
-  } while (!m_complete && timeout != 0);
+      leaseAt = deadline;
+    }
+  } while (!started && !m_complete && std::chrono::steady_clock::now() < deadline);
 
-  if (m_complete || timeout ==  0)
+  if (!started)
   {
     kodi::Log(ADDON_LOG_ERROR, "Could not buffer stream");
     StreamStop();
     return false;
   }
 
-  timeout = time(nullptr) + m_prebuffer;
-
-  while (timeout > time(nullptr))
-  {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-  }
-
   if (Buffer::Open(inputUrl, 0 ) == false)
   {
     kodi::Log(ADDON_LOG_ERROR, "Could not open streaming file");
@@ -80,18 +80,29 @@ bool ClientTimeShift::Open(const std::string inputUrl)
     return false;
   }
   m_sourceURL = inputUrl + "&seek=";
+  m_readPosition = 0;
+  m_underruns = 0;
+  StartProducer();
+  kodi::Log(ADDON_LOG_INFO, "Channel %d stream open after %lld ms", m_channel_id, ZapMilliseconds());
   m_rollingStartSeconds = m_streamStart = time(nullptr);
-  m_isLeaseRunning = true;
-  m_leaseThread = std::thread([this]()
-  {
-    LeaseWorker();
-  });
+  StartLease();
 
   return true;
 }
 
 PVR_ERROR ClientTimeShift::GetStreamTimes(kodi::addon::PVRStreamTimes& stimes)
 {
+  int64_t begin;
+  int64_t end;
+  if (m_tsIndex.TimeAt(SlipBufferStart(), begin) && m_tsIndex.TimeAt(m_stream_length, end))
+  {
+    // PCR time from the first byte, the same clock the demuxer reports playback on
+    stimes.SetStartTime(m_streamStart);
+    stimes.SetPTSStart(0);
+    stimes.SetPTSBegin(std::max(begin, static_cast<int64_t>(0)));
+    stimes.SetPTSEnd(end + static_cast<int64_t>(time(nullptr) - m_lengthTime) * STREAM_TIME_BASE);
+    return PVR_ERROR_NO_ERROR;
+  }
   stimes.SetStartTime(m_streamStart);
   stimes.SetPTSStart(0);
   stimes.SetPTSBegin(static_cast<int64_t>(m_rollingStartSeconds - m_streamStart) * STREAM_TIME_BASE);
@@ -101,12 +112,11 @@ PVR_ERROR ClientTimeShift::GetStreamTimes(kodi::addon::PVRStreamTimes& stimes)
 
 void ClientTimeShift::Close()
 {
+  StopProducer();
+  kodi::Log(ADDON_LOG_DEBUG, "ClientTimeShift read ahead underruns %d", m_underruns.load());
   if (m_active)
     Buffer::Close();
-  m_isLeaseRunning = false;
-
-  if (m_leaseThread.joinable())
-    m_leaseThread.join();
+  StopLease();
 
   StreamStop();
   kodi::Log(ADDON_LOG_DEBUG, "%s:%d:", __FUNCTION__, __LINE__);
@@ -115,14 +125,25 @@ void ClientTimeShift::Close()
 
 void ClientTimeShift::Resume()
 {
+  if (m_ring && !m_pauseStalled)
+  {
+    // the connection kept draining into the ring for the whole pause
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: resume from memory %lld buffered", __FUNCTION__, __LINE__, BufferedBytes());
+    return;
+  }
   ClientTimeShift::GetStreamInfo();
   if (m_stream_duration > m_settings.m_timeshiftBufferSeconds)
   {
-    int64_t startSlipBuffer = m_stream_length - (m_settings.m_timeshiftBufferSeconds * m_stream_length / m_stream_duration);
-    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld %lld", __FUNCTION__, __LINE__, startSlipBuffer, m_streamPosition, m_stream_length.load());
-    if (m_streamPosition < startSlipBuffer)
+    const int64_t startSlipBuffer = SlipBufferStart();
+    // with a full ring what is buffered stays playable, only the connection can fall behind
+    const int64_t position = m_ring ? m_ringOrigin + static_cast<int64_t>(m_ring->WriteTotal()) : m_streamPosition;
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld %lld %lld", __FUNCTION__, __LINE__, startSlipBuffer, m_streamPosition, position, m_stream_length.load());
+    if (position < startSlipBuffer)
     {
-      Seek(m_streamPosition, 0);
+      if (m_ring)
+        Reopen(m_streamPosition, 0);
+      else
+        Seek(m_streamPosition, 0);
     }
   }
   else
@@ -142,19 +163,33 @@ void ClientTimeShift::StreamStop()
 int64_t ClientTimeShift::Seek(int64_t position, int whence)
 {
   if (m_complete) return -1;
+  // short skips land in what was played or read ahead, no reconnect and no stream info round trip
+  if (m_ring && position >= m_ringOrigin && position >= SlipBufferStart() && m_ring->SeekTo(static_cast<uint64_t>(position - m_ringOrigin)))
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %d in window %lld-%lld", __FUNCTION__, __LINE__, position, whence, m_ringOrigin + m_ring->ReadFloor(), m_ringOrigin + m_ring->WriteTotal());
+    if (m_isPaused)
+      m_streamPosition = position;
+    m_readPosition = position;
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+    m_ringSpace.notify_one();
+    return position;
+  }
+  return Reopen(position, whence);
+}
+
+int64_t ClientTimeShift::Reopen(int64_t position, int whence)
+{
+  StopProducer();
   if (m_active)
     Buffer::Close();
   ClientTimeShift::GetStreamInfo();
 
-  if (m_stream_duration > m_settings.m_timeshiftBufferSeconds)
-  {
-    int64_t startSlipBuffer = m_stream_length - (m_settings.m_timeshiftBufferSeconds * m_stream_length/m_stream_duration);
-    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld %lld", __FUNCTION__, __LINE__, startSlipBuffer, position, m_stream_length.load());
-    if (position < startSlipBuffer)
-      position = startSlipBuffer;
-  }
+  const int64_t startSlipBuffer = SlipBufferStart();
+  kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld %lld", __FUNCTION__, __LINE__, startSlipBuffer, position, m_stream_length.load());
+  if (position < startSlipBuffer)
+    position = startSlipBuffer;
 
-  kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %d %lld %d", __FUNCTION__, __LINE__, position, whence, m_stream_duration.load(), m_isPaused);
+  kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %d %lld %d", __FUNCTION__, __LINE__, position, whence, m_stream_duration.load(), m_isPaused.load());
   if ( m_isPaused == true)
   {
     // skip while paused new restart position
@@ -166,6 +201,8 @@ int64_t ClientTimeShift::Seek(int64_t position, int whence)
     kodi::Log(ADDON_LOG_ERROR, "Could not open file on seek");
     return  -1;
   }
+  m_readPosition = position;
+  StartProducer();
   return position;
 }
 
@@ -200,6 +237,11 @@ bool ClientTimeShift::GetStreamInfo()
         {
           m_stream_length = strtoll(filesNode->FirstChildElement("stream_length")->GetText(), nullptr, 10);
           m_stream_duration = stream_duration / 1000;
+          m_lengthTime = time(nullptr);
+          m_bytesPerSecond = m_tsIndex.BytesPerSecond();
+          if (m_bytesPerSecond == 0)
+            m_bytesPerSecond = static_cast<int>(m_stream_length / std::max(m_stream_duration.load(), static_cast<int64_t>(1)));
+          m_tsIndex.Trim(SlipBufferStart());
           if (m_stream_duration > m_settings.m_timeshiftBufferSeconds)
           {
               m_rollingStartSeconds = m_streamStart + m_stream_duration - m_settings.m_timeshiftBufferSeconds;
@@ -217,7 +259,7 @@ bool ClientTimeShift::GetStreamInfo()
             kodi::QueueNotification(QUEUE_ERROR, kodi::addon::GetLocalizedString(30190), kodi::addon::GetLocalizedString(30053));
           }
         }
-        kodi::Log(ADDON_LOG_DEBUG, "CT channel.stream.info %lld %lld %d %lld", m_stream_length.load(), stream_duration, m_complete, m_rollingStartSeconds.load());
+        kodi::Log(ADDON_LOG_DEBUG, "CT channel.stream.info %lld %lld %d %lld %d", m_stream_length.load(), stream_duration, m_complete, m_rollingStartSeconds.load(), m_bytesPerSecond.load());
         infoReturn = OK;
       }
     }
@@ -230,3 +272,129 @@ bool ClientTimeShift::GetStreamInfo()
   m_nextStreamInfo = time(nullptr) + 10;
   return infoReturn == OK;
 }
+
+long long ClientTimeShift::ZapMilliseconds() const
+{
+  return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_zapStart).count());
+}
+
+void ClientTimeShift::LogZapTime()
+{
+  if (!m_zapLogged)
+  {
+    m_zapLogged = true;
+    kodi::Log(ADDON_LOG_INFO, "Channel %d zap time %lld ms", m_channel_id, ZapMilliseconds());
+  }
+}
+
+int64_t ClientTimeShift::SlipBufferStart() const
+{
+  // oldest byte still in the backend rolling file
+  if (m_stream_duration > m_settings.m_timeshiftBufferSeconds)
+  {
+    // by stream time when it is known, the average bitrate misses on variable bitrate channels
+    int64_t end;
+    int64_t offset;
+    if (m_tsIndex.TimeAt(m_stream_length, end) && m_tsIndex.OffsetAt(end - static_cast<int64_t>(m_settings.m_timeshiftBufferSeconds) * STREAM_TIME_BASE, offset))
+      return std::min(std::max(offset, static_cast<int64_t>(0)), m_stream_length.load());
+    return m_stream_length - (m_settings.m_timeshiftBufferSeconds * m_stream_length / m_stream_duration);
+  }
+  return 0;
+}
+
+void ClientTimeShift::StartProducer()
+{
+  // as much again as the read-ahead is kept behind the reader for skipping back
+  const size_t readAhead = static_cast<size_t>(m_settings.m_readAhead) * 1024 * 1024;
+  if (!m_ring || m_ring->Capacity() < readAhead * 2)
+    m_ring.reset(new RingBuffer(readAhead * 2));
+  m_ring->SetBackReserve(readAhead);
+  m_ring->Reset();
+  m_ringOrigin = m_readPosition;
+  m_inputEnded = false;
+  m_pauseStalled = false;
+  m_producerRunning = true;
+  m_producerThread = std::thread([this]()
+  {
+    ProducerWorker();
+  });
+}
+
+void ClientTimeShift::StopProducer()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+    m_producerRunning = false;
+  }
+  m_ringSpace.notify_all();
+  m_ringData.notify_all();
+  if (m_producerThread.joinable())
+    m_producerThread.join();
+}
+
+void ClientTimeShift::ProducerWorker()
+{
+  const size_t chunkSize = m_settings.m_liveChunkSize * 1024;
+  while (m_producerRunning)
+  {
+    if (m_ring->BytesFree() < chunkSize)
+    {
+      std::unique_lock<std::mutex> lock(m_ringMutex);
+      if (m_isPaused && !m_pauseStalled)
+      {
+        // from here the backend slip window can move past our connection
+        m_pauseStalled = true;
+        kodi::Log(ADDON_LOG_DEBUG, "%s:%d: ring full while paused", __FUNCTION__, __LINE__);
+      }
+      m_ringSpace.wait(lock, [&] { return !m_producerRunning || m_ring->BytesFree() >= chunkSize; });
+      if (!m_producerRunning)
+        break;
+    }
+    // the network read lands straight in the ring, Read keeps serving what is already there
+    size_t span;
+    byte* target = m_ring->WriteSpan(span);
+    const ssize_t dataLen = m_inputHandle.Read(target, std::min(span, chunkSize));
+    if (dataLen > 0)
+    {
+      m_tsIndex.Scan(target, static_cast<size_t>(dataLen), m_ringOrigin + static_cast<int64_t>(m_ring->WriteTotal()));
+      m_ring->CommitWrite(static_cast<size_t>(dataLen));
+      std::unique_lock<std::mutex> lock(m_ringMutex);
+      m_ringData.notify_one();
+    }
+    else if (m_complete)
+    {
+      kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld", __FUNCTION__, __LINE__, m_inputHandle.GetLength(), m_inputHandle.GetPosition());
+      std::unique_lock<std::mutex> lock(m_ringMutex);
+      m_inputEnded = true;
+      m_ringData.notify_one();
+      break;
+    }
+    else
+    {
+      // caught up with the live point, give the backend time to write more
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+}
+
+ssize_t ClientTimeShift::Read(byte *buffer, size_t length)
+{
+  if (m_ring == nullptr)
+    return -1;
+  if (m_ring->BytesAvailable() == 0 && !m_inputEnded)
+  {
+    m_underruns++;
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+    if (!m_ringData.wait_for(lock, std::chrono::seconds(m_readTimeout), [&] { return m_ring->BytesAvailable() > 0 || m_inputEnded || !m_producerRunning; }))
+      kodi::Log(ADDON_LOG_DEBUG, "%s:%d: read ahead empty after %d seconds", __FUNCTION__, __LINE__, m_readTimeout);
+  }
+  const size_t dataLen = m_ring->Read(buffer, length);
+  if (dataLen > 0)
+  {
+    LogZapTime();
+    m_readPosition += dataLen;
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+    m_ringSpace.notify_one();
+  }
+  return static_cast<ssize_t>(dataLen);
+}
@@ -9,6 +9,11 @@
 #pragma once
 
 #include "RecordingBuffer.h"
+#include "RingBuffer.h"
+#include "TsIndex.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <thread>
 #include <list>
 
@@ -18,8 +23,9 @@ namespace timeshift {
 
   class ATTR_DLL_LOCAL ClientTimeShift : public RecordingBuffer
   {
-  private:
-    bool m_isPaused = false;
+  protected:
+    std::atomic<bool> m_isPaused = { false };
+    std::atomic<bool> m_pauseStalled = { false };
     int64_t m_streamPosition;
 
 	/**
@@ -30,11 +36,44 @@ namespace timeshift {
   std::atomic<int64_t> m_stream_length;
   std::atomic<int64_t> m_stream_duration;
   std::atomic<int> m_bytesPerSecond;
+  // when m_stream_length was last updated
+  std::atomic<time_t> m_lengthTime = { 0 };
   time_t m_lastClose;
   int m_prebuffer;
   std::atomic<time_t> m_rollingStartSeconds;
   time_t m_streamStart;
 
+  /**
+   * Read-ahead, the producer thread keeps the ring filled from m_inputHandle
+   * and Read only copies out of memory. The mutex only guards the waits.
+   */
+  std::unique_ptr<RingBuffer> m_ring;
+  std::mutex m_ringMutex;
+  std::condition_variable m_ringData;
+  std::condition_variable m_ringSpace;
+  std::thread m_producerThread;
+  std::atomic<bool> m_producerRunning = { false };
+  std::atomic<bool> m_inputEnded = { false };
+  std::atomic<int64_t> m_readPosition = { 0 };
+  // stream position of the first byte the producer wrote into the ring
+  int64_t m_ringOrigin = 0;
+  std::atomic<int> m_underruns = { 0 };
+
+  // stream time of what has been read, for the slip window and stream times
+  TsIndex m_tsIndex;
+
+  virtual void StartProducer();
+  virtual void StopProducer();
+  void ProducerWorker();
+  int64_t SlipBufferStart() const;
+  int64_t Reopen(int64_t position, int whence);
+
+  // from channel.stream.start to the first bytes handed to Kodi
+  std::chrono::steady_clock::time_point m_zapStart;
+  bool m_zapLogged = false;
+  long long ZapMilliseconds() const;
+  void LogZapTime();
+
 
   public:
     ClientTimeShift() : RecordingBuffer()
@@ -48,8 +87,11 @@ namespace timeshift {
     {
       if ((m_isPaused = bPause))
       {
-        // pause save restart position
-        m_streamPosition = m_inputHandle.GetPosition();
+        // pause save restart position, the producer keeps filling the ring meanwhile
+        m_streamPosition = m_readPosition;
+        m_pauseStalled = false;
+        if (m_ring)
+          m_ring->ReleaseBackReserve();
       }
       else
       {
@@ -57,7 +99,7 @@ namespace timeshift {
       }
     }
 
-    virtual ~ClientTimeShift() {}
+    virtual ~ClientTimeShift() { StopLease(); StopProducer(); }
 
     virtual bool Open(const std::string inputUrl) override;
     virtual void Close() override;
@@ -71,16 +113,24 @@ namespace timeshift {
 
     virtual int64_t Position() const override
     {
-      return m_inputHandle.GetPosition();
+      return m_readPosition;
     }
-    virtual ssize_t Read(byte *buffer, size_t length) override
+    virtual ssize_t Read(byte *buffer, size_t length) override;
+
+    /**
+     * @return bytes read ahead and not yet passed to Kodi
+     */
+    virtual int64_t BufferedBytes() const
     {
-      ssize_t dataLen = m_inputHandle.Read(buffer, length);
-      if (m_complete && dataLen == 0)
-      {
-        kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %u %lld %lld", __FUNCTION__, __LINE__, length, m_inputHandle.GetLength() , m_inputHandle.GetPosition());
-      }
-      return dataLen;
+      return m_ring ? static_cast<int64_t>(m_ring->BytesAvailable()) : 0;
+    }
+
+    /**
+     * @return how often Read found the ring empty this session
+     */
+    int Underruns() const
+    {
+      return m_underruns;
     }
 
     void Resume();
@@ -0,0 +1,265 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "LocalTimeshift.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#if !defined(TARGET_WINDOWS)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+using namespace timeshift;
+
+LocalTimeShift::~LocalTimeShift()
+{
+  m_writing = false;
+  if (m_writeThread.joinable())
+    m_writeThread.join();
+  UnmapSpill();
+}
+
+bool LocalTimeShift::Open(const std::string inputUrl)
+{
+  if (!Buffer::Open(inputUrl))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "Could not open streaming file");
+    Buffer::Close();
+    return false;
+  }
+
+  // a 32 bit size_t would wrap for windows of 4 GB and more
+  uint64_t requested = static_cast<uint64_t>(std::max(m_settings.m_localTimeshiftSize, 0)) * 1024 * 1024;
+  if (sizeof(size_t) < sizeof(uint64_t))
+    requested = std::min(requested, static_cast<uint64_t>(LOCAL_TIMESHIFT_MAX_32BIT));
+  const size_t size = static_cast<size_t>(requested);
+  if (size <= 2 * LOCAL_TIMESHIFT_GUARD)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "LocalTimeShift size %d MB is too small", m_settings.m_localTimeshiftSize);
+    Buffer::Close();
+    return false;
+  }
+  if (!MapSpill(size))
+  {
+    // no spill file on this platform or disk, keep a smaller window in memory
+    m_size = std::min(size, static_cast<size_t>(LOCAL_TIMESHIFT_MEMORY));
+    m_data = new (std::nothrow) byte[m_size];
+    m_mapped = false;
+    if (m_data == nullptr)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "LocalTimeShift could not allocate %zu bytes", m_size);
+      m_size = 0;
+      Buffer::Close();
+      return false;
+    }
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "LocalTimeShift %zu bytes mapped %d", m_size, m_mapped);
+
+  m_streamUrl = inputUrl;
+  m_writePosition = 0;
+  m_readPosition = 0;
+  {
+    std::unique_lock<std::mutex> lock(m_timesMutex);
+    m_times.clear();
+    m_times.emplace_back(m_startTime, 0);
+  }
+  m_writing = true;
+  m_writeThread = std::thread([this]()
+  {
+    WriteWorker();
+  });
+  return true;
+}
+
+void LocalTimeShift::Close()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_dataMutex);
+    m_writing = false;
+  }
+  m_dataReady.notify_all();
+  if (m_writeThread.joinable())
+    m_writeThread.join();
+  Buffer::Close();
+  UnmapSpill();
+}
+
+bool LocalTimeShift::MapSpill(size_t size)
+{
+#if !defined(TARGET_WINDOWS)
+  m_spillFile = kodi::vfs::TranslateSpecialProtocol("special://userdata/addon_data/pvr.nextpvr/timeshift.spill");
+  const int fd = open(m_spillFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    return false;
+  // reserve the blocks now so a full disk shows up here and not as a fault during playback
+#if defined(__linux__)
+  bool allocated = posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#else
+  bool allocated = ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+  void* area = allocated ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (area == MAP_FAILED)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "LocalTimeShift could not map %s", m_spillFile.c_str());
+    kodi::vfs::DeleteFile(m_spillFile);
+    m_spillFile.clear();
+    return false;
+  }
+  m_data = static_cast<byte*>(area);
+  m_size = size;
+  m_mapped = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void LocalTimeShift::UnmapSpill()
+{
+#if !defined(TARGET_WINDOWS)
+  if (m_mapped)
+    munmap(m_data, m_size);
+  else
+#endif
+    delete[] m_data;
+  m_data = nullptr;
+  m_mapped = false;
+  if (!m_spillFile.empty())
+  {
+    kodi::vfs::DeleteFile(m_spillFile);
+    m_spillFile.clear();
+  }
+}
+
+int64_t LocalTimeShift::OldestPosition() const
+{
+  return std::max(static_cast<int64_t>(0), m_writePosition - static_cast<int64_t>(m_size - LOCAL_TIMESHIFT_GUARD));
+}
+
+void LocalTimeShift::WriteWorker()
+{
+  const size_t chunkSize = std::min(static_cast<size_t>(m_settings.m_liveChunkSize * 1024), static_cast<size_t>(LOCAL_TIMESHIFT_GUARD));
+  int idle = 0;
+  int reconnects = 0;
+  while (m_writing)
+  {
+    // the live stream never waits for the reader, the oldest bytes are overwritten instead
+    const size_t offset = static_cast<size_t>(m_writePosition % m_size);
+    const ssize_t dataLen = m_inputHandle.Read(m_data + offset, std::min(chunkSize, m_size - offset));
+    if (dataLen <= 0)
+    {
+      // live TV never goes quiet for the read timeout, the connection is gone
+      if (++idle * 100 < m_readTimeout * 1000)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        continue;
+      }
+      idle = 0;
+      if (reconnects++ == LOCAL_TIMESHIFT_RECONNECTS)
+      {
+        kodi::Log(ADDON_LOG_ERROR, "LocalTimeShift lost the live stream at %lld", m_writePosition.load());
+        break;
+      }
+      // a failed open reads nothing and comes back here after another timeout
+      Reconnect();
+      continue;
+    }
+    idle = 0;
+    reconnects = 0;
+    m_writePosition += dataLen;
+
+    const time_t now = time(nullptr);
+    {
+      std::unique_lock<std::mutex> lock(m_timesMutex);
+      if (m_times.back().first != now)
+        m_times.emplace_back(now, m_writePosition.load());
+      const int64_t oldest = OldestPosition();
+      while (m_times.size() > 1 && m_times[1].second <= oldest)
+        m_times.pop_front();
+    }
+    std::unique_lock<std::mutex> lock(m_dataMutex);
+    m_dataReady.notify_one();
+  }
+  // the reader plays out what is left and then sees the end of the stream
+  {
+    std::unique_lock<std::mutex> lock(m_dataMutex);
+    m_writing = false;
+  }
+  m_dataReady.notify_all();
+}
+
+void LocalTimeShift::Reconnect()
+{
+  kodi::Log(ADDON_LOG_INFO, "LocalTimeShift reconnecting at %lld", m_writePosition.load());
+  CloseHandle(m_inputHandle);
+  // the window keeps the timeline it started with
+  const time_t startTime = m_startTime;
+  if (!Buffer::Open(m_streamUrl))
+    kodi::Log(ADDON_LOG_ERROR, "LocalTimeShift could not reopen the live stream");
+  m_startTime = startTime;
+}
+
+ssize_t LocalTimeShift::Read(byte *buffer, size_t length)
+{
+  if (m_data == nullptr)
+    return -1;
+  const int64_t oldest = OldestPosition();
+  if (m_readPosition < oldest)
+  {
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: paused past the window, skipping %lld bytes", __FUNCTION__, __LINE__, oldest - m_readPosition);
+    m_readPosition = oldest;
+  }
+  if (m_writePosition == m_readPosition)
+  {
+    std::unique_lock<std::mutex> lock(m_dataMutex);
+    m_dataReady.wait_for(lock, std::chrono::seconds(m_readTimeout), [&] { return m_writePosition > m_readPosition || !m_writing; });
+  }
+
+  length = std::min(length, static_cast<size_t>(m_writePosition - m_readPosition));
+  const size_t offset = static_cast<size_t>(m_readPosition % m_size);
+  const size_t first = std::min(length, m_size - offset);
+  memcpy(buffer, m_data + offset, first);
+  if (length > first)
+    memcpy(buffer + first, m_data, length - first);
+  m_readPosition += length;
+  return static_cast<ssize_t>(length);
+}
+
+int64_t LocalTimeShift::Seek(int64_t position, int whence)
+{
+  if (m_data == nullptr)
+    return -1;
+  if (whence == SEEK_CUR)
+    position += m_readPosition;
+  else if (whence == SEEK_END)
+    position += m_writePosition;
+  else if (whence != SEEK_SET)
+    return -1;
+  position = std::min(std::max(position, OldestPosition()), m_writePosition.load());
+  kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld-%lld", __FUNCTION__, __LINE__, position, OldestPosition(), m_writePosition.load());
+  m_readPosition = position;
+  return position;
+}
+
+PVR_ERROR LocalTimeShift::GetStreamTimes(kodi::addon::PVRStreamTimes& stimes)
+{
+  time_t oldestTime = m_startTime;
+  {
+    std::unique_lock<std::mutex> lock(m_timesMutex);
+    if (!m_times.empty())
+      oldestTime = m_times.front().first;
+  }
+  stimes.SetStartTime(m_startTime);
+  stimes.SetPTSStart(0);
+  stimes.SetPTSBegin(static_cast<int64_t>(oldestTime - m_startTime) * STREAM_TIME_BASE);
+  stimes.SetPTSEnd(static_cast<int64_t>(time(nullptr) - m_startTime) * STREAM_TIME_BASE);
+  return PVR_ERROR_NO_ERROR;
+}
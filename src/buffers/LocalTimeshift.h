@@ -0,0 +1,97 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Buffer.h"
+#include <condition_variable>
+#include <deque>
+
+// space left ahead of the writer so a read in progress is never overwritten
+#define LOCAL_TIMESHIFT_GUARD (4 * 1024 * 1024)
+// largest window a 32 bit process can map next to Kodi itself
+#define LOCAL_TIMESHIFT_MAX_32BIT (1024 * 1024 * 1024)
+// window kept in memory when there is no spill file
+#define LOCAL_TIMESHIFT_MEMORY (256 * 1024 * 1024)
+// times a dropped live connection is opened again before the writer gives up
+#define LOCAL_TIMESHIFT_RECONNECTS 3
+
+namespace timeshift {
+
+  /**
+   * Timeshift kept on the client. The live stream is written to a
+   * preallocated spill file used as a ring and mapped into memory, so pause,
+   * rewind and skip forward never go back to the backend.
+   */
+  class ATTR_DLL_LOCAL LocalTimeShift : public Buffer
+  {
+  public:
+    LocalTimeShift() : Buffer()
+    {
+      kodi::Log(ADDON_LOG_INFO, "LocalTimeShift Buffer created!");
+    }
+
+    virtual ~LocalTimeShift();
+
+    virtual bool Open(const std::string inputUrl) override;
+    virtual void Close() override;
+
+    virtual ssize_t Read(byte *buffer, size_t length) override;
+    virtual int64_t Seek(int64_t position, int whence) override;
+
+    virtual bool CanPauseStream() const override
+    {
+      return true;
+    }
+
+    virtual bool CanSeekStream() const override
+    {
+      return true;
+    }
+
+    virtual bool IsTimeshifting() const override
+    {
+      return m_readPosition + LOCAL_TIMESHIFT_GUARD < m_writePosition;
+    }
+
+    virtual int64_t Position() const override
+    {
+      return m_readPosition;
+    }
+
+    virtual int64_t Length() const override
+    {
+      return m_writePosition;
+    }
+
+    virtual PVR_ERROR GetStreamTimes(kodi::addon::PVRStreamTimes& stimes) override;
+
+  private:
+    bool MapSpill(size_t size);
+    void UnmapSpill();
+    void WriteWorker();
+    void Reconnect();
+    int64_t OldestPosition() const;
+
+    std::string m_streamUrl;
+    std::string m_spillFile;
+    byte* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+
+    std::thread m_writeThread;
+    std::atomic<bool> m_writing = { false };
+    std::atomic<int64_t> m_writePosition = { 0 };
+    std::atomic<int64_t> m_readPosition = { 0 };
+    std::mutex m_dataMutex;
+    std::condition_variable m_dataReady;
+
+    // once a second, how much had been received
+    std::mutex m_timesMutex;
+    std::deque<std::pair<time_t, int64_t>> m_times;
+  };
+}
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ReadAheadFile.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace timeshift;
+
+ReadAheadFile::ReadAheadFile(const std::string& path, int64_t length, kodi::vfs::CFile& fallback) :
+  m_path(path), m_length(length), m_fallback(fallback)
+{
+}
+
+ReadAheadFile::~ReadAheadFile()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_work.notify_all();
+  m_blockReady.notify_all();
+  for (std::thread& worker : m_workers)
+  {
+    if (worker.joinable())
+      worker.join();
+  }
+  const double seconds = std::chrono::duration<double>(m_fetchTime).count();
+  kodi::Log(ADDON_LOG_DEBUG, "ReadAheadFile %lld bytes in %.1f s of reads, depth %d, %d waits", m_bytesFetched, seconds, m_depth, m_waits);
+}
+
+void ReadAheadFile::Schedule()
+{
+  // called locked, drop what is behind the reader and queue the window ahead of it
+  const int64_t first = m_position / READAHEAD_BLOCK_SIZE;
+  for (auto it = m_blocks.begin(); it != m_blocks.end();)
+  {
+    if (it->first < first || it->first >= first + READAHEAD_MAX_DEPTH)
+      it = m_blocks.erase(it);
+    else
+      ++it;
+  }
+  m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [&](int64_t block) { return m_blocks.find(block) == m_blocks.end(); }), m_pending.end());
+
+  // one handle per block in flight, opened as the depth grows and not while the share refuses them
+  while (static_cast<int>(m_workers.size()) < m_depth && m_openFailures == 0)
+  {
+    m_liveWorkers++;
+    m_workers.emplace_back([this] { Worker(); });
+  }
+
+  const int64_t lastBlock = (m_length - 1) / READAHEAD_BLOCK_SIZE;
+  for (int64_t block = first; block < first + m_depth && block <= lastBlock; block++)
+  {
+    if (m_blocks.find(block) == m_blocks.end())
+    {
+      m_blocks.emplace(block, std::make_shared<Block>());
+      m_pending.emplace_back(block);
+    }
+  }
+  m_work.notify_all();
+}
+
+void ReadAheadFile::Worker()
+{
+  // each worker has its own handle so the share sees several requests at once
+  kodi::vfs::CFile input;
+  if (!input.OpenFile(m_path, ADDON_READ_NO_CACHE | ADDON_READ_CHUNKED | ADDON_READ_AUDIO_VIDEO))
+  {
+    kodi::Log(ADDON_LOG_ERROR, "ReadAheadFile could not open %s", m_path.c_str());
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_liveWorkers--;
+    m_openFailures++;
+    m_blockReady.notify_all();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (m_running)
+  {
+    if (m_pending.empty())
+    {
+      m_work.wait(lock);
+      continue;
+    }
+    // nearest block first
+    auto next = std::min_element(m_pending.begin(), m_pending.end());
+    const int64_t index = *next;
+    m_pending.erase(next);
+    std::shared_ptr<Block> block = m_blocks[index];
+    lock.unlock();
+
+    const int64_t offset = index * READAHEAD_BLOCK_SIZE;
+    const size_t size = static_cast<size_t>(std::min(static_cast<int64_t>(READAHEAD_BLOCK_SIZE), m_length - offset));
+    std::vector<byte> data(size);
+    const auto start = std::chrono::steady_clock::now();
+    size_t received = 0;
+    if (input.Seek(offset, SEEK_SET) == offset)
+    {
+      while (received < size)
+      {
+        const ssize_t dataLen = input.Read(data.data() + received, size - received);
+        if (dataLen <= 0)
+          break;
+        received += dataLen;
+      }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    lock.lock();
+    m_fetchTime += elapsed;
+    m_bytesFetched += received;
+    block->failed = received != size;
+    block->data.swap(data);
+    block->data.resize(received);
+    block->ready = true;
+    m_blockReady.notify_all();
+  }
+}
+
+ssize_t ReadAheadFile::Read(byte* buffer, size_t length)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  size_t copied = 0;
+  while (copied < length && m_position < m_length)
+  {
+    Schedule();
+    if (m_liveWorkers == 0)
+      break;
+    const int64_t index = m_position / READAHEAD_BLOCK_SIZE;
+    std::shared_ptr<Block> block = m_blocks[index];
+    if (!block->ready)
+    {
+      // playback caught up with the reads, keep more of them in flight
+      m_waits++;
+      m_blocksWithoutWait = 0;
+      if (m_depth < READAHEAD_MAX_DEPTH)
+        m_depth++;
+      if (!m_blockReady.wait_for(lock, std::chrono::seconds(READAHEAD_TIMEOUT), [&] { return block->ready || !m_running || m_liveWorkers == 0; }))
+      {
+        kodi::Log(ADDON_LOG_ERROR, "ReadAheadFile no data at %lld after %d seconds", m_position.load(), READAHEAD_TIMEOUT);
+        break;
+      }
+      if (!m_running || m_liveWorkers == 0)
+        break;
+    }
+    const size_t offset = static_cast<size_t>(m_position - index * READAHEAD_BLOCK_SIZE);
+    if (offset >= block->data.size())
+    {
+      // short read from the share, try that block again next time
+      m_blocks.erase(index);
+      break;
+    }
+    const size_t count = std::min(length - copied, block->data.size() - offset);
+    memcpy(buffer + copied, block->data.data() + offset, count);
+    copied += count;
+    m_position += count;
+    if (offset + count == block->data.size() && ++m_blocksWithoutWait >= 32 && m_depth > READAHEAD_MIN_DEPTH)
+    {
+      m_depth--;
+      m_blocksWithoutWait = 0;
+    }
+    if (block->failed && offset + count == block->data.size())
+    {
+      m_blocks.erase(index);
+      break;
+    }
+  }
+  Schedule();
+  if (copied > 0 || m_position >= m_length || !m_running)
+    return static_cast<ssize_t>(copied);
+
+  // 0 would end playback, a hiccup on the read ahead handles is not the end of the recording
+  lock.unlock();
+  return ReadDirect(buffer, length);
+}
+
+ssize_t ReadAheadFile::ReadDirect(byte* buffer, size_t length)
+{
+  const int64_t position = m_position;
+  if (m_fallback.Seek(position, SEEK_SET) != position)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "ReadAheadFile could not seek to %lld", position);
+    return -1;
+  }
+  const ssize_t dataLen = m_fallback.Read(buffer, length);
+  if (dataLen <= 0)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "ReadAheadFile no data at %lld", position);
+    return -1;
+  }
+  m_position += dataLen;
+  return dataLen;
+}
+
+int64_t ReadAheadFile::Seek(int64_t position, int whence)
+{
+  if (whence == SEEK_CUR)
+    position += m_position;
+  else if (whence == SEEK_END)
+    position += m_length;
+  else if (whence != SEEK_SET)
+    return -1;
+  if (position < 0 || position > m_length)
+    return -1;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_position = position;
+  Schedule();
+  return position;
+}
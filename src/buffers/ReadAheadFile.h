@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Buffer.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <vector>
+
+#define READAHEAD_BLOCK_SIZE (1024 * 1024)
+#define READAHEAD_MIN_DEPTH 2
+#define READAHEAD_MAX_DEPTH 8
+#define READAHEAD_TIMEOUT 10
+
+namespace timeshift {
+
+  /**
+   * Reads a finished recording on a network share ahead of Kodi as large
+   * aligned blocks, several at once on separate handles. The number of
+   * blocks kept in flight grows when playback has to wait and shrinks
+   * again when it has not for a while. Handles are opened as the depth
+   * grows, when a block comes back short or late the read goes to the
+   * caller's own handle instead.
+   */
+  class ATTR_DLL_LOCAL ReadAheadFile
+  {
+  public:
+    ReadAheadFile(const std::string& path, int64_t length, kodi::vfs::CFile& fallback);
+    ~ReadAheadFile();
+
+    ReadAheadFile(ReadAheadFile const&) = delete;
+    void operator=(ReadAheadFile const&) = delete;
+
+    ssize_t Read(byte* buffer, size_t length);
+    int64_t Seek(int64_t position, int whence);
+    int64_t Position() const { return m_position; }
+    int64_t Length() const { return m_length; }
+
+  private:
+    struct Block
+    {
+      std::vector<byte> data;
+      bool ready = false;
+      bool failed = false;
+    };
+
+    void Worker();
+    void Schedule();
+    ssize_t ReadDirect(byte* buffer, size_t length);
+
+    const std::string m_path;
+    const int64_t m_length;
+    kodi::vfs::CFile& m_fallback;
+    std::atomic<int64_t> m_position = { 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_blockReady;
+    std::condition_variable m_work;
+    std::map<int64_t, std::shared_ptr<Block>> m_blocks;
+    std::vector<int64_t> m_pending;
+    std::vector<std::thread> m_workers;
+    bool m_running = true;
+    // workers that have or are opening a handle, none left means reading through m_fallback
+    int m_liveWorkers = 0;
+    int m_openFailures = 0;
+
+    int m_depth = READAHEAD_MIN_DEPTH;
+    int m_blocksWithoutWait = 0;
+    int m_waits = 0;
+    int64_t m_bytesFetched = 0;
+    std::chrono::steady_clock::duration m_fetchTime = std::chrono::steady_clock::duration::zero();
+  };
+}
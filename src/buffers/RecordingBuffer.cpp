@@ -9,6 +9,7 @@
 #include "../BackendRequest.h"
 #include "../utilities/XMLUtils.h"
 #include "RecordingBuffer.h"
+#include "TailFollower.h"
 
 using namespace NextPVR::utilities;
 using namespace timeshift;
@@ -100,27 +101,40 @@ bool RecordingBuffer::Open(const std::string inputUrl, const kodi::addon::PVRRec
       m_recordingURL = kodiDirectory;
     }
   }
-  return Buffer::Open(m_recordingURL, ADDON_READ_NO_CACHE);
+  if (!Buffer::Open(m_recordingURL, ADDON_READ_NO_CACHE))
+    return false;
+  if (m_recordingURL != inputUrl && m_inputHandle.GetLength() > READAHEAD_BLOCK_SIZE)
+  {
+    // finished recording on a share, keep several large reads in flight instead of Kodi's small ones
+    m_readAhead.reset(new ReadAheadFile(m_recordingURL, m_inputHandle.GetLength(), m_inputHandle));
+  }
+  return true;
 }
 
 ssize_t RecordingBuffer::Read(byte *buffer, size_t length)
 {
+  if (m_readAhead)
+    return m_readAhead->Read(buffer, length);
   if (m_recordingTime)
     std::unique_lock<std::mutex> lock(m_mutex);
   ssize_t dataRead = (int) m_inputHandle.Read(buffer, length);
   if (dataRead == 0 && m_isLive)
   {
+    // follow the tail, a file handle sees new data on the next read, an HTTP response that has ended needs a new request
     kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld", __FUNCTION__, __LINE__, m_inputHandle.GetLength() , m_inputHandle.GetPosition());
     const int64_t position = m_inputHandle.GetPosition();
-    const time_t startTime = time(nullptr);
-    do {
-      Buffer::Close();
-      std::this_thread::sleep_for(std::chrono::milliseconds(2000));
-      Buffer::Open(m_recordingURL);
-      Seek(position, 0);
-      dataRead = m_inputHandle.Read(buffer, length);
-    } while (dataRead == 0 && time(nullptr) - startTime < 5);
-    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld", __FUNCTION__, __LINE__, m_inputHandle.GetLength() , m_inputHandle.GetPosition());
+    const bool directFile = m_recordingURL.rfind("http", 0) != 0;
+    const TailFollower follower(directFile ? TailFollower::ForFile() : TailFollower::ForHttp());
+    const auto start = std::chrono::steady_clock::now();
+    dataRead = follower.Follow(buffer, length,
+      [this](byte* data, size_t size) { return m_inputHandle.Read(data, size); },
+      [this, position]()
+      {
+        Buffer::Close();
+        return Buffer::Open(m_recordingURL) && m_inputHandle.Seek(position, SEEK_SET) == position;
+      });
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %lld %lld after %lld ms", __FUNCTION__, __LINE__, m_inputHandle.GetLength() , m_inputHandle.GetPosition(),
+              static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()));
   }
   return dataRead;
 }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "Buffer.h"
+#include "ReadAheadFile.h"
 
 
 namespace timeshift {
@@ -24,15 +25,24 @@ namespace timeshift {
     bool m_buffering = false;
     std::string m_recordingURL;
     std::string m_recordingID;
+    std::unique_ptr<ReadAheadFile> m_readAhead;
 
   public:
     RecordingBuffer() : Buffer() { m_Duration = 0; kodi::Log(ADDON_LOG_INFO, "RecordingBuffer created!"); }
     virtual ~RecordingBuffer() {}
 
+    virtual void Close() override
+    {
+      m_readAhead.reset();
+      Buffer::Close();
+    }
+
     virtual ssize_t Read(byte *buffer, size_t length) override;
 
     virtual int64_t Seek(int64_t position, int whence) override
     {
+      if (m_readAhead)
+        return m_readAhead->Seek(position, whence);
       int64_t retval = m_inputHandle.Seek(position, whence);
       kodi::Log(ADDON_LOG_DEBUG, "Seek: %s:%d  %lld  %lld %lld %lld", __FUNCTION__, __LINE__, position, m_inputHandle.GetPosition(), m_inputHandle.GetLength(), retval );
       return retval;
@@ -45,7 +55,7 @@ namespace timeshift {
 
     virtual bool CanSeekStream() const override
     {
-      return m_inputHandle.GetLength() != 0;
+      return Length() != 0;
     }
 
     virtual bool IsRealTimeStream() const override
@@ -57,10 +67,14 @@ namespace timeshift {
 
     virtual int64_t Length() const override
     {
+      if (m_readAhead)
+        return m_readAhead->Length();
       return m_inputHandle.GetLength();
     }
     virtual int64_t Position() const override
     {
+      if (m_readAhead)
+        return m_readAhead->Position();
       return m_inputHandle.GetPosition();
     }
 
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "RingBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+using namespace timeshift;
+
+RingBuffer::RingBuffer(size_t size)
+{
+  size_t pageSize = 4096;
+#if defined(__linux__)
+  pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  m_size = std::max(pageSize, (size + pageSize - 1) / pageSize * pageSize);
+  if (!MapMirrored())
+  {
+    m_data = new byte[m_size];
+    m_mirrored = false;
+  }
+  kodi::Log(ADDON_LOG_DEBUG, "RingBuffer %zu bytes mirrored %d", m_size, m_mirrored);
+}
+
+RingBuffer::~RingBuffer()
+{
+#if defined(__linux__)
+  if (m_mirrored)
+  {
+    munmap(m_data, m_size * 2);
+    return;
+  }
+#endif
+  delete[] m_data;
+}
+
+bool RingBuffer::MapMirrored()
+{
+#if defined(__linux__) && defined(__NR_memfd_create)
+  // one shared memory object mapped twice, the second copy starts where the first ends
+  const int fd = static_cast<int>(syscall(__NR_memfd_create, "pvr.nextpvr.ring", 0));
+  if (fd < 0)
+    return false;
+  bool mapped = false;
+  if (ftruncate(fd, static_cast<off_t>(m_size)) == 0)
+  {
+    void* area = mmap(nullptr, m_size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area != MAP_FAILED)
+    {
+      byte* base = static_cast<byte*>(area);
+      if (mmap(base, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == base &&
+          mmap(base + m_size, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == base + m_size)
+      {
+        m_data = base;
+        m_mirrored = mapped = true;
+      }
+      else
+      {
+        munmap(area, m_size * 2);
+      }
+    }
+  }
+  close(fd);
+  return mapped;
+#else
+  return false;
+#endif
+}
+
+byte* RingBuffer::WriteSpan(size_t& length)
+{
+  const uint64_t head = m_head.load(std::memory_order_relaxed);
+  const size_t offset = static_cast<size_t>(head % m_size);
+  length = m_size - static_cast<size_t>(head - m_floor.load(std::memory_order_acquire));
+  if (!m_mirrored)
+    length = std::min(length, m_size - offset);
+  return m_data + offset;
+}
+
+void RingBuffer::CommitWrite(size_t length)
+{
+  m_head.store(m_head.load(std::memory_order_relaxed) + length, std::memory_order_release);
+}
+
+bool RingBuffer::Write(const byte* buffer, size_t length)
+{
+  if (length > BytesFree())
+    return false;
+  while (length > 0)
+  {
+    size_t span;
+    byte* target = WriteSpan(span);
+    span = std::min(span, length);
+    memcpy(target, buffer, span);
+    CommitWrite(span);
+    buffer += span;
+    length -= span;
+  }
+  return true;
+}
+
+const byte* RingBuffer::ReadSpan(size_t& length)
+{
+  const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+  const size_t offset = static_cast<size_t>(tail % m_size);
+  length = static_cast<size_t>(m_head.load(std::memory_order_acquire) - tail);
+  if (!m_mirrored)
+    length = std::min(length, m_size - offset);
+  return m_data + offset;
+}
+
+void RingBuffer::CommitRead(size_t length)
+{
+  const uint64_t tail = m_tail.load(std::memory_order_relaxed) + length;
+  m_tail.store(tail, std::memory_order_release);
+  if (tail > m_backReserve && tail - m_backReserve > m_floor.load(std::memory_order_relaxed))
+    m_floor.store(tail - m_backReserve, std::memory_order_release);
+}
+
+bool RingBuffer::SeekTo(uint64_t total)
+{
+  if (total < m_floor.load(std::memory_order_acquire) || total > m_head.load(std::memory_order_acquire))
+    return false;
+  m_tail.store(total, std::memory_order_release);
+  if (total > m_backReserve && total - m_backReserve > m_floor.load(std::memory_order_relaxed))
+    m_floor.store(total - m_backReserve, std::memory_order_release);
+  return true;
+}
+
+size_t RingBuffer::Read(byte* buffer, size_t length)
+{
+  size_t copied = 0;
+  while (copied < length)
+  {
+    size_t span;
+    const byte* source = ReadSpan(span);
+    span = std::min(span, length - copied);
+    if (span == 0)
+      break;
+    memcpy(buffer + copied, source, span);
+    CommitRead(span);
+    copied += span;
+  }
+  return copied;
+}
+
+void RingBuffer::Reset()
+{
+  m_head.store(0, std::memory_order_release);
+  m_tail.store(0, std::memory_order_release);
+  m_floor.store(0, std::memory_order_release);
+}
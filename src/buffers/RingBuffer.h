@@ -0,0 +1,118 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+//
+// Single producer, single consumer ring. Where the platform allows the
+// storage is mapped twice back to back so any span up to the capacity is
+// contiguous, elsewhere spans stop at the wrap and callers loop.
+//
+
+#include "Buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace timeshift {
+
+  class ATTR_DLL_LOCAL RingBuffer
+  {
+  public:
+    /**
+     * @param size requested capacity, rounded up to the page size
+     */
+    explicit RingBuffer(size_t size);
+    ~RingBuffer();
+
+    RingBuffer(RingBuffer const&) = delete;
+    void operator=(RingBuffer const&) = delete;
+
+    size_t Capacity() const { return m_size; }
+    bool IsMirrored() const { return m_mirrored; }
+
+    size_t BytesAvailable() const
+    {
+      return static_cast<size_t>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Space the producer may fill, bytes held back behind the reader count as used
+     */
+    size_t BytesFree() const
+    {
+      return m_size - static_cast<size_t>(m_head.load(std::memory_order_acquire) - m_floor.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Keep up to this many already read bytes so the consumer can go back to them
+     */
+    void SetBackReserve(size_t bytes) { m_backReserve = std::min(bytes, m_size / 2); }
+
+    /**
+     * Consumer side, gives the bytes held back so far to the producer
+     */
+    void ReleaseBackReserve() { m_floor.store(m_tail.load(std::memory_order_acquire), std::memory_order_release); }
+
+    /**
+     * Running totals, the consumer may move anywhere between ReadFloor and WriteTotal
+     */
+    uint64_t ReadTotal() const { return m_tail.load(std::memory_order_acquire); }
+    uint64_t WriteTotal() const { return m_head.load(std::memory_order_acquire); }
+    uint64_t ReadFloor() const { return m_floor.load(std::memory_order_acquire); }
+
+    /**
+     * Consumer side, moves the read point to an earlier or later total
+     * @return false when those bytes are not held any more or not here yet
+     */
+    bool SeekTo(uint64_t total);
+
+    /**
+     * Producer side, returns where the next bytes go and sets length to how
+     * many can be written there. Make them visible with CommitWrite.
+     */
+    byte* WriteSpan(size_t& length);
+    void CommitWrite(size_t length);
+
+    /**
+     * Copies the whole block in or nothing
+     * @return false when there is not enough free space
+     */
+    bool Write(const byte* buffer, size_t length);
+
+    /**
+     * Consumer side, returns the next unread bytes and sets length to how
+     * many are readable there. Release them with CommitRead.
+     */
+    const byte* ReadSpan(size_t& length);
+    void CommitRead(size_t length);
+
+    /**
+     * @return bytes copied, at most length
+     */
+    size_t Read(byte* buffer, size_t length);
+
+    /**
+     * Empties the ring, only while neither side is running
+     */
+    void Reset();
+
+  private:
+    bool MapMirrored();
+
+    byte* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mirrored = false;
+    size_t m_backReserve = 0;
+    // running totals, the index into m_data is the total modulo m_size
+    alignas(64) std::atomic<uint64_t> m_head = { 0 };
+    alignas(64) std::atomic<uint64_t> m_tail = { 0 };
+    // oldest byte the producer may not overwrite, only ever moves forward
+    std::atomic<uint64_t> m_floor = { 0 };
+  };
+}
@@ -0,0 +1,86 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <sys/types.h>
+#include <thread>
+
+namespace timeshift {
+
+  /**
+   * Waits at the end of a recording that is still being written until more
+   * data can be read. Kept free of Kodi so it can be tested on its own.
+   *
+   * A file handle sees appended data on the next read, so it is polled
+   * quickly with a backoff and only reopened now and then. An HTTP response
+   * that has ended never grows, so for HTTP every attempt is a new request
+   * from the current position.
+   */
+  class TailFollower
+  {
+  public:
+    using ReadFunc = std::function<ssize_t(unsigned char* buffer, size_t length)>;
+    using ReopenFunc = std::function<bool()>;
+
+    struct Policy
+    {
+      bool pollHandle;
+      std::chrono::milliseconds firstWait;
+      std::chrono::milliseconds maxWait;
+      std::chrono::milliseconds reopenInterval;
+      std::chrono::milliseconds limit;
+    };
+
+    static Policy ForFile()
+    {
+      return { true, std::chrono::milliseconds(20), std::chrono::milliseconds(500), std::chrono::milliseconds(2000), std::chrono::milliseconds(5000) };
+    }
+
+    static Policy ForHttp()
+    {
+      return { false, std::chrono::milliseconds(250), std::chrono::milliseconds(1000), std::chrono::milliseconds(0), std::chrono::milliseconds(5000) };
+    }
+
+    explicit TailFollower(const Policy& policy) : m_policy(policy) {}
+
+    /**
+     * Called after a read returned 0.
+     * @param read reads from the current handle
+     * @param reopen opens a new handle at the same position
+     * @return bytes read, 0 when nothing arrived within the limit
+     */
+    ssize_t Follow(unsigned char* buffer, size_t length, const ReadFunc& read, const ReopenFunc& reopen) const
+    {
+      const auto start = std::chrono::steady_clock::now();
+      auto lastOpen = start;
+      std::chrono::milliseconds wait = m_policy.firstWait;
+      ssize_t dataRead = 0;
+      do
+      {
+        std::this_thread::sleep_for(wait);
+        wait = std::min(wait * 2, m_policy.maxWait);
+        if (m_policy.pollHandle)
+          dataRead = read(buffer, length);
+        const auto now = std::chrono::steady_clock::now();
+        if (dataRead <= 0 && now - lastOpen >= m_policy.reopenInterval)
+        {
+          lastOpen = now;
+          dataRead = reopen() ? read(buffer, length) : 0;
+        }
+      } while (dataRead <= 0 && std::chrono::steady_clock::now() - start < m_policy.limit);
+      return std::max<ssize_t>(dataRead, 0);
+    }
+
+  private:
+    const Policy m_policy;
+  };
+}
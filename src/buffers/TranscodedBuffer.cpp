@@ -41,12 +41,8 @@ bool TranscodedBuffer::Open(const std::string inputUrl)
       m_nextLease = 0;
       m_nextStreamInfo = std::numeric_limits<time_t>::max();
       m_nextRoll = std::numeric_limits<time_t>::max();
-      m_isLeaseRunning = true;
       m_complete = false;
-      m_leaseThread = std::thread([this]()
-      {
-        LeaseWorker();
-      });
+      StartLease();
       return true;
     }
   }
@@ -59,11 +55,8 @@ void TranscodedBuffer::Close()
   {
     m_active = false;
     m_complete = true;
-    m_isLeaseRunning = false;
-    if (m_leaseThread.joinable()){
-      m_leaseThread.detach();
-      kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %d", __FUNCTION__, __LINE__, m_leaseThread.joinable());
-    }
+    // may be called from the lease task itself, which then just is not run again
+    StopLease();
     m_request.DoActionRequest("channel.transcode.stop");
   }
 }
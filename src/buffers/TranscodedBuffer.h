@@ -22,7 +22,7 @@ namespace timeshift {
       kodi::Log(ADDON_LOG_INFO, "TranscodedBuffer created");
     }
 
-    ~TranscodedBuffer() {}
+    ~TranscodedBuffer() { StopLease(); }
 
     bool Open(const std::string inputUrl);
 
@@ -0,0 +1,226 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "TsIndex.h"
+#include <cstring>
+
+using namespace timeshift;
+
+namespace
+{
+  const int64_t PCR_WRAP = 1LL << 33;
+  const int64_t PCR_HZ = 90000;
+}
+
+void TsIndex::Reset()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_carryLength = 0;
+  m_nextOffset = -1;
+  m_pcrPid = -1;
+  m_firstPcr = -1;
+  m_lastPcr = 0;
+  m_wrap = 0;
+  m_lastEntry = -1;
+}
+
+void TsIndex::Scan(const byte* data, size_t length, int64_t offset)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (offset != m_nextOffset)
+  {
+    // seek or reconnect, find the packets again
+    m_carryLength = 0;
+    m_lastEntry = -1;
+  }
+  m_nextOffset = offset + length;
+
+  size_t pos = 0;
+  if (m_carryLength > 0)
+  {
+    const size_t needed = std::min(TS_PACKET_SIZE - m_carryLength, length);
+    memcpy(m_carry + m_carryLength, data, needed);
+    m_carryLength += needed;
+    if (m_carryLength < TS_PACKET_SIZE)
+      return;
+    Packet(m_carry, offset + needed - TS_PACKET_SIZE);
+    m_carryLength = 0;
+    pos = needed;
+  }
+
+  while (pos + TS_PACKET_SIZE <= length)
+  {
+    if (data[pos] != TS_SYNC_BYTE)
+    {
+      // lost sync, a packet starts where the sync byte repeats one and two packets on
+      const byte* found = data + pos;
+      while ((found = static_cast<const byte*>(memchr(found, TS_SYNC_BYTE, length - (found - data)))) != nullptr)
+      {
+        const size_t at = found - data;
+        if ((at + TS_PACKET_SIZE >= length || data[at + TS_PACKET_SIZE] == TS_SYNC_BYTE) &&
+            (at + 2 * TS_PACKET_SIZE >= length || data[at + 2 * TS_PACKET_SIZE] == TS_SYNC_BYTE))
+          break;
+        found++;
+      }
+      if (found == nullptr)
+        return;
+      pos = found - data;
+      m_lastEntry = -1;
+      continue;
+    }
+    Packet(data + pos, offset + pos);
+    pos += TS_PACKET_SIZE;
+  }
+
+  if (pos < length && data[pos] == TS_SYNC_BYTE)
+  {
+    m_carryLength = length - pos;
+    memcpy(m_carry, data + pos, m_carryLength);
+  }
+}
+
+void TsIndex::Packet(const byte* packet, int64_t offset)
+{
+  // transport error or no adaptation field
+  if ((packet[1] & 0x80) || !(packet[3] & 0x20))
+    return;
+  // adaptation field long enough for a PCR and the PCR flag set
+  if (packet[4] < 7 || !(packet[5] & 0x10))
+    return;
+  const int pid = ((packet[1] & 0x1f) << 8) | packet[2];
+  if (m_pcrPid == -1)
+    m_pcrPid = pid;
+  else if (pid != m_pcrPid)
+    return;
+
+  if (packet[5] & 0x80)
+  {
+    // the clock restarts here, earlier entries no longer line up
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: PCR discontinuity at %lld", __FUNCTION__, __LINE__, offset);
+    m_entries.clear();
+    m_firstPcr = -1;
+    m_wrap = 0;
+    m_lastEntry = -1;
+  }
+
+  int64_t pcr = (static_cast<int64_t>(packet[6]) << 25) | (packet[7] << 17) | (packet[8] << 9) | (packet[9] << 1) | (packet[10] >> 7);
+  pcr += m_wrap;
+  if (m_firstPcr == -1)
+  {
+    m_firstPcr = pcr;
+  }
+  else if (pcr < m_lastPcr - PCR_WRAP / 2)
+  {
+    m_wrap += PCR_WRAP;
+    pcr += PCR_WRAP;
+  }
+  else if (pcr > m_lastPcr + PCR_WRAP / 2 && m_wrap > 0)
+  {
+    // back across a wrap after a seek
+    m_wrap -= PCR_WRAP;
+    pcr -= PCR_WRAP;
+  }
+  m_lastPcr = pcr;
+
+  const int64_t time = pcr - m_firstPcr;
+  if (m_lastEntry != -1 && time >= m_lastEntry && time - m_lastEntry < TS_INDEX_INTERVAL)
+    return;
+  m_entries[offset] = time;
+  m_lastEntry = time;
+}
+
+void TsIndex::Trim(int64_t offset)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  // keep the entry just before offset so it can still be interpolated
+  auto it = m_entries.lower_bound(offset);
+  if (it != m_entries.begin())
+    m_entries.erase(m_entries.begin(), std::prev(it));
+}
+
+int TsIndex::BytesPerSecondLocked() const
+{
+  if (m_entries.size() < 2)
+    return 0;
+  const auto& first = *m_entries.begin();
+  const auto& last = *m_entries.rbegin();
+  if (last.second <= first.second)
+    return 0;
+  return static_cast<int>((last.first - first.first) * PCR_HZ / (last.second - first.second));
+}
+
+int TsIndex::BytesPerSecond() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return BytesPerSecondLocked();
+}
+
+size_t TsIndex::Entries() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+bool TsIndex::TimeAt(int64_t offset, int64_t& time) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const int rate = BytesPerSecondLocked();
+  if (rate == 0)
+    return false;
+  auto next = m_entries.upper_bound(offset);
+  int64_t pcrTime;
+  if (next == m_entries.begin())
+  {
+    pcrTime = next->second - (next->first - offset) * PCR_HZ / rate;
+  }
+  else if (next == m_entries.end())
+  {
+    const auto& last = *m_entries.rbegin();
+    pcrTime = last.second + (offset - last.first) * PCR_HZ / rate;
+  }
+  else
+  {
+    const auto prev = std::prev(next);
+    pcrTime = prev->second + (offset - prev->first) * (next->second - prev->second) / (next->first - prev->first);
+  }
+  time = pcrTime * STREAM_TIME_BASE / PCR_HZ;
+  return true;
+}
+
+bool TsIndex::OffsetAt(int64_t time, int64_t& offset) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const int rate = BytesPerSecondLocked();
+  if (rate == 0)
+    return false;
+  const int64_t pcrTime = time * PCR_HZ / STREAM_TIME_BASE;
+  auto next = m_entries.begin();
+  while (next != m_entries.end() && next->second <= pcrTime)
+    ++next;
+  int64_t base;
+  if (next == m_entries.begin())
+  {
+    base = next->first;
+    offset = base - (next->second - pcrTime) * rate / PCR_HZ;
+  }
+  else if (next == m_entries.end())
+  {
+    const auto& last = *m_entries.rbegin();
+    base = last.first;
+    offset = base + (pcrTime - last.second) * rate / PCR_HZ;
+  }
+  else
+  {
+    const auto prev = std::prev(next);
+    base = prev->first;
+    offset = base + (pcrTime - prev->second) * (next->first - prev->first) / (next->second - prev->second);
+  }
+  // entries are packet starts, land on one too
+  offset -= ((offset - base) % TS_PACKET_SIZE + TS_PACKET_SIZE) % TS_PACKET_SIZE;
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include "Buffer.h"
+#include <map>
+
+#define TS_PACKET_SIZE 188
+#define TS_SYNC_BYTE 0x47
+// 90 kHz ticks between index entries
+#define TS_INDEX_INTERVAL 45000
+
+namespace timeshift {
+
+  /**
+   * Maps stream offsets to stream time for an MPEG-TS stream. Data is fed
+   * in as it is read, only the four header bytes of each packet are looked
+   * at and a PCR is kept about twice a second, so scanning costs next to
+   * nothing. Times are in STREAM_TIME_BASE from the first PCR seen.
+   */
+  class ATTR_DLL_LOCAL TsIndex
+  {
+  public:
+    void Reset();
+
+    /**
+     * Scans data read from the stream at offset. Data need not start on a
+     * packet, a jump in offset starts a new run.
+     */
+    void Scan(const byte* data, size_t length, int64_t offset);
+
+    /**
+     * Drops entries for data before offset
+     */
+    void Trim(int64_t offset);
+
+    /**
+     * @return stream time at offset, false until there are two entries
+     */
+    bool TimeAt(int64_t offset, int64_t& time) const;
+
+    /**
+     * @return offset of the stream time, false until there are two entries
+     */
+    bool OffsetAt(int64_t time, int64_t& offset) const;
+
+    /**
+     * @return the bitrate across the indexed range, 0 when unknown
+     */
+    int BytesPerSecond() const;
+
+    size_t Entries() const;
+
+  private:
+    void Packet(const byte* packet, int64_t offset);
+    int BytesPerSecondLocked() const;
+
+    mutable std::mutex m_mutex;
+    // offset to 90 kHz time
+    std::map<int64_t, int64_t> m_entries;
+    byte m_carry[TS_PACKET_SIZE];
+    size_t m_carryLength = 0;
+    int64_t m_nextOffset = -1;
+    int m_pcrPid = -1;
+    int64_t m_firstPcr = -1;
+    int64_t m_lastPcr = 0;
+    int64_t m_wrap = 0;
+    int64_t m_lastEntry = -1;
+  };
+}
@@ -8,6 +8,8 @@
 #include "pvrclient-nextpvr.h"
 
 #include "BackendRequest.h"
+#include "utilities/ChunkSizeTuner.h"
+#include "utilities/Scheduler.h"
 #include "utilities/XMLUtils.h"
 #include "kodi/General.h"
 #include <kodi/Network.h>
@@ -81,6 +83,20 @@ std::string UriEncode(const std::string sSrc)
 
 #define FAST_SLOW_POLL_TRANSITION 65
 
+// seconds before a scheduled recording that the standby tuner is handed back
+#define STANDBY_TIMER_LEAD 180
+// seconds live TV can stay stopped before the standby tuner is handed back
+#define STANDBY_IDLE_RELEASE 10
+// milliseconds the standby drain gets to finish its read before the session is closed under it
+#define STANDBY_STOP_WAIT 250
+
+// seconds between session renewals while playing, well inside the hour a session lasts
+#define SID_RENEW_INTERVAL 600
+// milliseconds between checks that a transcode is still running
+#define TRANSCODE_CHECK 2500
+// seconds Process() sleeps with nothing due, state changes expedite it
+#define PROCESS_IDLE_WAIT 3600
+
 /************************************************************/
 /** Class interface */
 
@@ -93,10 +109,11 @@ cPVRClientNextPVR::cPVRClientNextPVR(const CNextPVRAddon& base, const kodi::addo
   m_timeshiftBuffer = new timeshift::DummyBuffer();
   m_recordingBuffer = new timeshift::RecordingBuffer();
   m_realTimeBuffer = new timeshift::DummyBuffer();
+  m_standbyBuffer = new timeshift::DummyBuffer();
   m_livePlayer = nullptr;
   m_nowPlaying = NotPlaying;
-  m_running = true;
-  m_thread = std::thread([&] { Process(); });
+  m_processTask = Scheduler::GetInstance().Schedule(std::chrono::milliseconds(0), [this] { return Process(); });
+  m_changeTask = Scheduler::GetInstance().Schedule(std::chrono::seconds(CHANGE_POLL_NORMAL), [this] { return CheckForChanges(); });
 }
 
 cPVRClientNextPVR::~cPVRClientNextPVR()
@@ -110,9 +127,13 @@ cPVRClientNextPVR::~cPVRClientNextPVR()
       CloseLiveStream();
   }
 
-  m_running = false;
-  if (m_thread.joinable())
-    m_thread.join();
+  Scheduler::GetInstance().Cancel(m_processTask);
+  Scheduler::GetInstance().Cancel(m_changeTask);
+  m_epg.StopRefresh();
+  m_channels.StopIconFetch();
+  ReleaseStandby();
+  Scheduler::GetInstance().Stop();
+  Scheduler::GetLeaseInstance().Stop();
 
   kodi::Log(ADDON_LOG_DEBUG, "->~cPVRClientNextPVR()");
   if (m_bConnected)
@@ -120,9 +141,9 @@ cPVRClientNextPVR::~cPVRClientNextPVR()
   delete m_timeshiftBuffer;
   delete m_recordingBuffer;
   delete m_realTimeBuffer;
+  delete m_standbyBuffer;
   m_recordings.m_hostFilenames.clear();
-  m_channels.m_channelDetails.clear();
-  m_channels.m_liveStreams.clear();
+  m_channels.ClearChannelDetails();
 }
 
 ADDON_STATUS cPVRClientNextPVR::Connect(bool sendWOL)
@@ -208,6 +229,7 @@ ADDON_STATUS cPVRClientNextPVR::Connect(bool sendWOL)
         m_nextServerCheck = time(nullptr) + SLOW_CONNECT_POLL;
       else
         m_nextServerCheck = time(nullptr) + FAST_CONNECT_POLL;
+      ExpediteProcess(m_nextServerCheck + 1);
     }
     else
     {
@@ -224,6 +246,7 @@ void cPVRClientNextPVR::ResetConnection()
   m_nextServerCheck = 0;
   m_connectionState = PVR_CONNECTION_STATE_DISCONNECTED;
   m_bConnected = false;
+  ExpediteProcess(0);
 }
 
 void cPVRClientNextPVR::Disconnect()
@@ -271,8 +294,20 @@ void cPVRClientNextPVR::ConfigurePostConnectionOptions()
     {
       m_timeshiftBuffer = new timeshift::ClientTimeShift();
     }
+    else if (m_settings.m_liveStreamingMethod == eStreamingMethod::BlockTimeshift)
+    {
+      m_timeshiftBuffer = new timeshift::BlockTimeShift();
+    }
+    else if (m_settings.m_liveStreamingMethod == eStreamingMethod::LocalTimeshift)
+    {
+      m_timeshiftBuffer = new timeshift::LocalTimeShift();
+    }
   }
 
+  // channels and guide may have changed while we were away
+  m_channels.InvalidateSnapshot();
+  m_epg.ClearCache();
+
   const bool liveStreams = kodi::addon::GetSettingBoolean("uselivestreams");
   if (liveStreams)
       m_channels.LoadLiveStreams();
@@ -288,88 +323,19 @@ void cPVRClientNextPVR::ConfigurePostConnectionOptions()
  */
 bool cPVRClientNextPVR::IsUp()
 {
-  // check time since last time Recordings were updated, update if it has been awhile
-  if (m_bConnected == true)
+  // live TV was stopped rather than changed, give the standby tuner back
+  if (m_nowPlaying == NotPlaying && m_standbyIdleSince != 0 && time(nullptr) > m_standbyIdleSince + STANDBY_IDLE_RELEASE)
+    ReleaseStandby();
+  // and let the backend have it for a recording that is about to start
+  else if (m_standbyRunning && TimerStartsSoon())
   {
-    if (m_nowPlaying == NotPlaying && m_lastRecordingUpdateTime != std::numeric_limits<time_t>::max() && time(nullptr) > (m_lastRecordingUpdateTime + 60))
-    {
-      time_t update_time;
-      if (m_request.GetLastUpdate("recording.lastupdated", update_time) == tinyxml2::XML_SUCCESS)
-      {
-        if (m_connectionState == PVR_CONNECTION_STATE_DISCONNECTED)
-          // one time failure resolved
-          m_connectionState = PVR_CONNECTION_STATE_CONNECTED;
+    kodi::Log(ADDON_LOG_INFO, "Warm standby released for a recording starting at %lld", static_cast<long long>(m_timers.NextTimerStart()));
+    ReleaseStandby();
+  }
 
-        if (update_time > m_lastRecordingUpdateTime)
-        {
-          m_lastRecordingUpdateTime = std::numeric_limits<time_t>::max();
-          time_t lastUpdate;
-          if (m_request.GetLastUpdate("system.epg.summary", lastUpdate) == tinyxml2::XML_SUCCESS)
-          {
-            if (lastUpdate > m_lastEPGUpdateTime)
-            {
-              // trigger EPG updates for all channels with a guide source
-              kodi::Log(ADDON_LOG_DEBUG, "Trigger EPG update start");
-              int channels = 0;
-              for (const auto &updateChannel : m_channels.m_channelDetails)
-              {
-                if (updateChannel.second.first == false)
-                {
-                  channels++;
-                  TriggerEpgUpdate(updateChannel.first);
-                }
-              }
-              kodi::Log(ADDON_LOG_DEBUG, "Triggered %d channel updates", channels);
-
-              m_lastEPGUpdateTime = lastUpdate;
-              m_lastRecordingUpdateTime = update_time;
-              return m_bConnected;
-            }
-          }
-          if (update_time <= m_timers.m_lastTimerUpdateTime + 1)
-          {
-            // we already updated this one in Kodi
-            m_lastRecordingUpdateTime = time(nullptr);
-            return m_bConnected;
-          }
-          if (m_request.GetLastUpdate("recording.lastupdated&ignore_resume=true", lastUpdate) == tinyxml2::XML_SUCCESS)
-          {
-            if (lastUpdate <= m_timers.m_lastTimerUpdateTime)
-            {
-              if (m_settings.m_backendResume)
-              {
-                // only resume position changed
-                m_recordings.GetRecordingsLastPlayedPosition();
-                m_lastRecordingUpdateTime = update_time;
-              }
-              return m_bConnected;
-            }
-          }
-          g_pvrclient->TriggerRecordingUpdate();
-          g_pvrclient->TriggerTimerUpdate();
-        }
-        else
-        {
-          m_lastRecordingUpdateTime = time(nullptr);
-        }
-      }
-      else
-      {
-        if (m_connectionState == PVR_CONNECTION_STATE_CONNECTED)
-        {
-          // allow a one time retry in 60 seconds
-          m_connectionState = PVR_CONNECTION_STATE_SERVER_UNREACHABLE;
-          m_lastRecordingUpdateTime = time(nullptr);
-        }
-        else if (m_connectionState == PVR_CONNECTION_STATE_SERVER_UNREACHABLE)
-        {
-          SetConnectionState("Lost connection", PVR_CONNECTION_STATE_SERVER_UNREACHABLE);
-          m_nextServerCheck = time(nullptr) + SLOW_CONNECT_POLL;
-          m_bConnected = false;
-        }
-      }
-    }
-    else if (m_nowPlaying != NotPlaying)
+  if (m_bConnected == true)
+  {
+    if (m_nowPlaying != NotPlaying)
     {
       m_request.RenewSID();
       if (m_nowPlaying == Transcoding)
@@ -398,18 +364,129 @@ bool cPVRClientNextPVR::IsUp()
   return m_bConnected;
 }
 
-void cPVRClientNextPVR::Process()
+std::chrono::milliseconds cPVRClientNextPVR::Process()
 {
-  while (m_running)
+  IsUp();
+  // the backend ends a transcode without telling us
+  if (m_bConnected && m_nowPlaying == Transcoding)
+    return std::chrono::milliseconds(TRANSCODE_CHECK);
+
+  const time_t now = time(nullptr);
+  time_t next = now + PROCESS_IDLE_WAIT;
+  const time_t standby = StandbyDeadline();
+  if (standby != 0)
+    next = std::min(next, standby);
+  if (m_bConnected)
+  {
+    if (m_nowPlaying != NotPlaying)
+      next = std::min(next, now + SID_RENEW_INTERVAL);
+  }
+  else if ((m_connectionState == PVR_CONNECTION_STATE_SERVER_UNREACHABLE || m_connectionState == PVR_CONNECTION_STATE_DISCONNECTED) &&
+           m_nextServerCheck != std::numeric_limits<time_t>::max())
   {
-    IsUp();
-    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    // IsUp() waits for the check time to pass
+    next = std::min(next, m_nextServerCheck + 1);
   }
+  return std::chrono::seconds(std::max<time_t>(next - now, 0));
+}
+
+void cPVRClientNextPVR::ExpediteProcess(time_t deadline)
+{
+  Scheduler::GetInstance().Expedite(m_processTask, std::chrono::seconds(std::max<time_t>(deadline - time(nullptr), 0)));
+}
+
+/* CheckForChanges()
+ * \brief   Poll recording.lastupdated, which moves with any recording, timer or guide change,
+ *          and only when it moved find out which Kodi updates to trigger
+ * \return  Time until the next check
+ */
+std::chrono::milliseconds cPVRClientNextPVR::CheckForChanges()
+{
+  if (!m_bConnected || m_nowPlaying != NotPlaying || m_changeMonitor.Paused() || m_lastRecordingUpdateTime == std::numeric_limits<time_t>::max())
+    return m_changeMonitor.Interval();
+
+  time_t update_time;
+  if (m_request.GetLastUpdate("recording.lastupdated", update_time) != tinyxml2::XML_SUCCESS)
+  {
+    if (m_connectionState == PVR_CONNECTION_STATE_CONNECTED)
+    {
+      // allow a one time retry
+      m_connectionState = PVR_CONNECTION_STATE_SERVER_UNREACHABLE;
+    }
+    else if (m_connectionState == PVR_CONNECTION_STATE_SERVER_UNREACHABLE)
+    {
+      SetConnectionState("Lost connection", PVR_CONNECTION_STATE_SERVER_UNREACHABLE);
+      m_nextServerCheck = time(nullptr) + SLOW_CONNECT_POLL;
+      m_bConnected = false;
+      ExpediteProcess(m_nextServerCheck + 1);
+    }
+    return std::chrono::seconds(CHANGE_POLL_NORMAL);
+  }
+
+  if (m_connectionState == PVR_CONNECTION_STATE_DISCONNECTED)
+    // one time failure resolved
+    m_connectionState = PVR_CONNECTION_STATE_CONNECTED;
+
+  if (update_time <= m_lastRecordingUpdateTime)
+    return m_changeMonitor.Polled(false);
+
+  m_lastRecordingUpdateTime = std::numeric_limits<time_t>::max();
+  time_t lastUpdate;
+  if (m_request.GetLastUpdate("system.epg.summary", lastUpdate) == tinyxml2::XML_SUCCESS)
+  {
+    if (lastUpdate > m_lastEPGUpdateTime)
+    {
+      // the next channel load picks up backend channel changes
+      m_channels.InvalidateSnapshot();
+      // trigger EPG updates for channels with a guide source that changed
+      kodi::Log(ADDON_LOG_DEBUG, "Trigger EPG update start");
+      int channels = m_epg.UpdateGuide();
+      kodi::Log(ADDON_LOG_DEBUG, "Triggered %d channel updates", channels);
+
+      m_lastEPGUpdateTime = lastUpdate;
+      m_lastRecordingUpdateTime = update_time;
+      return m_changeMonitor.Polled(true);
+    }
+  }
+  if (update_time <= m_timers.m_lastTimerUpdateTime + 1)
+  {
+    // we already updated this one in Kodi
+    m_lastRecordingUpdateTime = update_time;
+    return m_changeMonitor.Polled(false);
+  }
+  if (m_request.GetLastUpdate("recording.lastupdated&ignore_resume=true", lastUpdate) == tinyxml2::XML_SUCCESS)
+  {
+    if (lastUpdate <= m_timers.m_lastTimerUpdateTime)
+    {
+      // only resume position changed
+      if (m_settings.m_backendResume)
+        m_recordings.GetRecordingsLastPlayedPosition();
+      m_lastRecordingUpdateTime = update_time;
+      return m_changeMonitor.Polled(true);
+    }
+  }
+  // reloading recordings sets the new token
+  TriggerRecordingUpdate();
+  TriggerTimerUpdate();
+  return m_changeMonitor.Polled(true);
+}
+
+void cPVRClientNextPVR::ExpectChanges()
+{
+  m_changeMonitor.Activity();
+  Scheduler::GetInstance().Expedite(m_changeTask, std::chrono::seconds(CHANGE_POLL_FAST));
+}
+
+void cPVRClientNextPVR::ForceRecordingUpdate()
+{
+  m_lastRecordingUpdateTime = 0;
+  ExpectChanges();
 }
 
 PVR_ERROR cPVRClientNextPVR::OnSystemSleep()
 {
   m_bConnected = false;
+  m_changeMonitor.Pause();
   m_lastRecordingUpdateTime = std::numeric_limits<time_t>::max();
   m_nextServerCheck = std::numeric_limits<time_t>::max();
   m_connectionState = PVR_CONNECTION_STATE_DISCONNECTED;
@@ -420,7 +497,8 @@ PVR_ERROR cPVRClientNextPVR::OnSystemWake()
 {
   kodi::Log(ADDON_LOG_DEBUG, "NextPVR wake");
   // allow time for core to reset
-  m_lastRecordingUpdateTime = time(nullptr) + SLOW_CONNECT_POLL;
+  m_lastRecordingUpdateTime = time(nullptr);
+  m_changeMonitor.Resume(std::chrono::seconds(SLOW_CONNECT_POLL));
   m_nextServerCheck = 0;
   // don't trigger updates core does it
   SetConnectionState("Reconnect", PVR_CONNECTION_STATE_UNKNOWN);
@@ -512,9 +590,10 @@ PVR_ERROR cPVRClientNextPVR::GetDriveSpace(uint64_t& total, uint64_t& used)
 PVR_ERROR cPVRClientNextPVR::GetChannelStreamProperties(const kodi::addon::PVRChannel& channel, std::vector<kodi::addon::PVRStreamProperty>& properties)
 {
   bool liveStream = m_channels.IsChannelAPlugin(channel.GetUniqueId());
-  if (liveStream)
+  std::string url;
+  if (liveStream && m_channels.GetLiveStream(channel.GetUniqueId(), url))
   {
-    properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, m_channels.m_liveStreams[channel.GetUniqueId()]);
+    properties.emplace_back(PVR_STREAM_PROPERTY_STREAMURL, url);
     properties.emplace_back(PVR_STREAM_PROPERTY_ISREALTIMESTREAM, "true");
     return PVR_ERROR_NO_ERROR;
   }
@@ -526,12 +605,13 @@ PVR_ERROR cPVRClientNextPVR::GetChannelStreamProperties(const kodi::addon::PVRCh
       m_nowPlaying = NotPlaying;
       m_livePlayer = nullptr;
     }
-    const std::string line = kodi::tools::StringUtils::Format("%s/service?method=channel.transcode.m3u8&sid=%s", m_settings.m_urlBase, m_request.GetSID());
+    const std::string line = kodi::tools::StringUtils::Format("%s/service?method=channel.transcode.m3u8&sid=%s", m_settings.m_urlBase, m_request.GetSID().c_str());
     m_livePlayer = m_timeshiftBuffer;
     m_livePlayer->Channel(channel.GetUniqueId());
     if (m_livePlayer->Open(line))
     {
       m_nowPlaying = Transcoding;
+      ExpediteProcess(0);
     }
     else
     {
@@ -575,36 +655,213 @@ bool cPVRClientNextPVR::OpenLiveStream(const kodi::addon::PVRChannel& channel)
   {
     m_nowPlaying = Radio;
   }
-  if (m_channels.m_liveStreams.count(channel.GetUniqueId()) != 0)
+  // renew the session from now on
+  ExpediteProcess(0);
+  ChunkSizeTuner::GetInstance().Start(m_nowPlaying == Radio ? StreamKind::Radio : StreamKind::Live);
+  if (m_channels.GetLiveStream(channel.GetUniqueId(), line))
   {
-    line = m_channels.m_liveStreams[channel.GetUniqueId()];
     m_livePlayer = m_realTimeBuffer;
     return m_livePlayer->Open(line, ADDON_READ_CACHED);
   }
-  else if (m_settings.m_liveStreamingMethod == ClientTimeshift)
+  else if (m_settings.m_liveStreamingMethod == ClientTimeshift || m_settings.m_liveStreamingMethod == BlockTimeshift)
+  {
+    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=%s&sid=%s", m_settings.m_urlBase, channel.GetUniqueId(), m_request.GetSID().c_str(), m_request.GetSID().c_str());
+    m_livePlayer = m_timeshiftBuffer;
+    m_livePlayer->Channel(channel.GetUniqueId());
+  }
+  else if (m_settings.m_liveStreamingMethod == LocalTimeshift)
   {
-    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=%s&sid=%s", m_settings.m_urlBase, channel.GetUniqueId(), m_request.GetSID(), m_request.GetSID());
+    // plain live stream, the buffer keeps its own timeshift
+    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-%s", m_settings.m_urlBase, channel.GetUniqueId(), m_request.GetSID().c_str());
     m_livePlayer = m_timeshiftBuffer;
     m_livePlayer->Channel(channel.GetUniqueId());
   }
   else
   {
-    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-%s", m_settings.m_urlBase, channel.GetUniqueId(), m_request.GetSID());
+    if (TakeStandby(channel.GetUniqueId()))
+    {
+      m_livePlayer = m_realTimeBuffer;
+      StartStandby(channel);
+      return true;
+    }
+    line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-%s", m_settings.m_urlBase, channel.GetUniqueId(), m_request.GetSID().c_str());
     m_livePlayer = m_realTimeBuffer;
   }
   kodi::Log(ADDON_LOG_INFO, "Calling Open(%s) on tsb!", line.c_str());
   if (m_livePlayer->Open(line))
   {
+    if (m_livePlayer == m_realTimeBuffer)
+      StartStandby(channel);
     return true;
   }
   return false;
 }
 
+bool cPVRClientNextPVR::TakeStandby(int channelUid)
+{
+  std::unique_lock<std::mutex> lock(m_standbyMutex);
+  m_standbyIdleSince = 0;
+  const bool drained = StopStandbyDrain();
+  // nothing predicted, or the spare tuner was not available for it
+  if (m_standbyChannel == 0)
+    return false;
+  m_standbyZaps++;
+  const bool hit = m_standbyChannel == channelUid && drained;
+  if (hit && m_standbyReady)
+  {
+    // the standby session becomes the live one, the old buffer waits for the next prediction
+    std::swap(m_realTimeBuffer, m_standbyBuffer);
+    m_standbyHits++;
+  }
+  else
+  {
+    // free the tuner before asking the backend for a different channel
+    m_standbyBuffer->Close();
+  }
+  kodi::Log(ADDON_LOG_INFO, "Warm standby %s channel %d, %d hits in %d changes", hit && m_standbyReady ? "hit" : "missed", channelUid, m_standbyHits, m_standbyZaps);
+  const bool taken = hit && m_standbyReady;
+  m_standbyChannel = 0;
+  m_standbyReady = false;
+  return taken;
+}
+
+void cPVRClientNextPVR::StartStandby(const kodi::addon::PVRChannel& channel)
+{
+  if (!m_settings.m_warmStandby)
+    return;
+  const int uid = channel.GetUniqueId();
+
+  // keep going the way the user is zapping, otherwise expect a jump back to the last channel.
+  // this can load the channel list, so it is done before taking the standby lock
+  int predicted;
+  if (m_lastLiveChannel == 0)
+    predicted = m_channels.GetAdjacentChannel(uid, 1);
+  else if (m_channels.GetAdjacentChannel(m_lastLiveChannel, 1) == uid)
+    predicted = m_channels.GetAdjacentChannel(uid, 1);
+  else if (m_channels.GetAdjacentChannel(m_lastLiveChannel, -1) == uid)
+    predicted = m_channels.GetAdjacentChannel(uid, -1);
+  else
+    predicted = m_lastLiveChannel;
+  m_lastLiveChannel = uid;
+  if (TimerStartsSoon())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_standbyMutex);
+  // a failed open means no spare tuner, leave it alone for a while
+  if (predicted == 0 || predicted == uid || time(nullptr) < m_standbyBackoff || m_standbyThread.joinable())
+    return;
+
+  const std::string line = kodi::tools::StringUtils::Format("%s/live?channeloid=%d&client=XBMC-standby-%s", m_settings.m_urlBase, predicted, m_request.GetSID().c_str());
+  m_standbyChannel = predicted;
+  m_standbyReady = false;
+  m_standbyRunning = true;
+  m_standbyDrainDone = false;
+  m_standbyThread = std::thread([this, line, predicted]()
+  {
+    if (!m_standbyBuffer->Open(line))
+    {
+      kodi::Log(ADDON_LOG_INFO, "Warm standby for channel %d not available", predicted);
+      m_standbyBackoff = time(nullptr) + 300;
+      // not a prediction any more, the next change is neither a hit nor a miss
+      m_standbyChannel = 0;
+    }
+    else
+    {
+      m_standbyReady = true;
+      // drain so the backend keeps the session at the live point
+      std::vector<unsigned char> discard(64 * 1024);
+      while (m_standbyRunning)
+      {
+        if (m_standbyBuffer->Read(discard.data(), discard.size()) <= 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+    }
+    {
+      std::unique_lock<std::mutex> lock(m_standbyDrainMutex);
+      m_standbyDrainDone = true;
+    }
+    m_standbyDrainStopped.notify_all();
+  });
+  lock.unlock();
+  // a recording due soon takes the tuner back
+  ExpectStandbyDeadline();
+}
+
+bool cPVRClientNextPVR::StopStandbyDrain()
+{
+  // called with m_standbyMutex held, which is why a read stalled on the backend must not be waited out
+  m_standbyRunning = false;
+  if (!m_standbyThread.joinable())
+    return true;
+  bool stopped;
+  {
+    std::unique_lock<std::mutex> lock(m_standbyDrainMutex);
+    stopped = m_standbyDrainStopped.wait_for(lock, std::chrono::milliseconds(STANDBY_STOP_WAIT), [this] { return m_standbyDrainDone; });
+  }
+  if (!stopped)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Warm standby channel %d stalled, closing it", m_standbyChannel.load());
+    m_standbyBuffer->Close();
+  }
+  m_standbyThread.join();
+  return stopped;
+}
+
+bool cPVRClientNextPVR::TimerStartsSoon() const
+{
+  const time_t nextStart = m_timers.NextTimerStart();
+  return nextStart != 0 && nextStart < time(nullptr) + STANDBY_TIMER_LEAD;
+}
+
+/* StandbyDeadline()
+ * \brief   When IsUp() next has to release the standby tuner
+ * \return  The time, or 0 when nothing is due
+ */
+time_t cPVRClientNextPVR::StandbyDeadline() const
+{
+  // IsUp() waits for each deadline to pass
+  time_t deadline = 0;
+  if (m_nowPlaying == NotPlaying && m_standbyIdleSince != 0)
+    deadline = m_standbyIdleSince + STANDBY_IDLE_RELEASE + 1;
+  const time_t nextStart = m_timers.NextTimerStart();
+  if (m_standbyRunning && nextStart != 0 && (deadline == 0 || nextStart - STANDBY_TIMER_LEAD + 1 < deadline))
+    deadline = nextStart - STANDBY_TIMER_LEAD + 1;
+  return deadline;
+}
+
+void cPVRClientNextPVR::ExpectStandbyDeadline()
+{
+  const time_t deadline = StandbyDeadline();
+  if (deadline != 0)
+    ExpediteProcess(deadline);
+}
+
+void cPVRClientNextPVR::ReleaseStandby()
+{
+  std::unique_lock<std::mutex> lock(m_standbyMutex);
+  StopStandbyDrain();
+  if (m_standbyChannel != 0)
+  {
+    m_standbyBuffer->Close();
+    kodi::Log(ADDON_LOG_DEBUG, "Warm standby released channel %d", m_standbyChannel.load());
+  }
+  m_standbyChannel = 0;
+  m_standbyReady = false;
+  m_standbyIdleSince = 0;
+}
+
 int cPVRClientNextPVR::ReadLiveStream(unsigned char* pBuffer, unsigned int iBufferSize)
 {
   if (IsServerStreamingLive())
   {
-    return m_livePlayer->Read(pBuffer, iBufferSize);
+    // the timeshift buffers copy out of memory, only direct reads show what the network delivers
+    if (m_livePlayer != m_realTimeBuffer)
+      return m_livePlayer->Read(pBuffer, iBufferSize);
+    const auto start = std::chrono::steady_clock::now();
+    const int dataLen = m_livePlayer->Read(pBuffer, iBufferSize);
+    if (dataLen > 0)
+      ChunkSizeTuner::GetInstance().Sample(m_nowPlaying == Radio ? StreamKind::Radio : StreamKind::Live, dataLen, std::chrono::steady_clock::now() - start);
+    return dataLen;
   }
   return -1;
 }
@@ -617,7 +874,14 @@ void cPVRClientNextPVR::CloseLiveStream(void)
     m_livePlayer->Close();
     m_livePlayer = nullptr;
   }
+  ChunkSizeTuner::GetInstance().Stop(m_nowPlaying == Radio ? StreamKind::Radio : StreamKind::Live);
   m_nowPlaying = NotPlaying;
+  {
+    std::unique_lock<std::mutex> lock(m_standbyMutex);
+    if (m_standbyChannel != 0)
+      m_standbyIdleSince = time(nullptr);
+  }
+  ExpectStandbyDeadline();
 }
 
 int64_t cPVRClientNextPVR::SeekLiveStream(int64_t iPosition, int iWhence)
@@ -688,10 +952,13 @@ bool cPVRClientNextPVR::CanSeekStream(void)
 
 bool cPVRClientNextPVR::OpenRecordedStream(const kodi::addon::PVRRecording& recording)
 {
+  ReleaseStandby();
   kodi::addon::PVRRecording copyRecording = recording;
   m_nowPlaying = Recording;
+  ExpediteProcess(0);
+  ChunkSizeTuner::GetInstance().Start(StreamKind::Recording);
   copyRecording.SetDirectory(m_recordings.m_hostFilenames[recording.GetRecordingId()]);
-  const std::string line = kodi::tools::StringUtils::Format("%s/live?recording=%s&client=XBMC-%s", m_settings.m_urlBase, recording.GetRecordingId().c_str(), m_request.GetSID());
+  const std::string line = kodi::tools::StringUtils::Format("%s/live?recording=%s&client=XBMC-%s", m_settings.m_urlBase, recording.GetRecordingId().c_str(), m_request.GetSID().c_str());
   return m_recordingBuffer->Open(line, copyRecording);
 }
 
@@ -702,6 +969,7 @@ void cPVRClientNextPVR::CloseRecordedStream(void)
     m_recordingBuffer->Close();
     m_recordingBuffer->SetDuration(0);
   }
+  ChunkSizeTuner::GetInstance().Stop(StreamKind::Recording);
   m_nowPlaying = NotPlaying;
 }
 
@@ -709,7 +977,11 @@ int cPVRClientNextPVR::ReadRecordedStream(unsigned char* pBuffer, unsigned int i
 {
   if (IsServerStreamingRecording())
   {
-    return m_recordingBuffer->Read(pBuffer, iBufferSize);
+    const auto start = std::chrono::steady_clock::now();
+    const int dataLen = m_recordingBuffer->Read(pBuffer, iBufferSize);
+    if (dataLen > 0)
+      ChunkSizeTuner::GetInstance().Sample(StreamKind::Recording, dataLen, std::chrono::steady_clock::now() - start);
+    return dataLen;
   }
   return -1;
 }
@@ -769,13 +1041,22 @@ PVR_ERROR cPVRClientNextPVR::GetStreamReadChunkSize(int& chunksize)
 {
   if (IsServerStreaming())
   {
-    if (m_nowPlaying == TV)
-      return m_livePlayer->GetStreamReadChunkSize(chunksize);
+    ChunkSizeTuner& tuner = ChunkSizeTuner::GetInstance();
+    PVR_ERROR error = PVR_ERROR_NO_ERROR;
     if (m_nowPlaying == Recording)
-      chunksize = m_settings.m_chunkRecording * 1024;
-    else if (m_nowPlaying == Radio)
-      chunksize = 4096;
-    return PVR_ERROR_NO_ERROR;
+      chunksize = tuner.ChunkSize(StreamKind::Recording, m_settings.m_chunkRecording * 1024);
+    else if (m_nowPlaying == TV || m_nowPlaying == Radio)
+    {
+      if (m_nowPlaying == TV)
+        error = m_livePlayer->GetStreamReadChunkSize(chunksize);
+      else
+        chunksize = 4096;
+      // reads from a timeshift buffer are not sampled, it keeps its own size
+      if (m_livePlayer == m_realTimeBuffer)
+        chunksize = tuner.ChunkSize(m_nowPlaying == Radio ? StreamKind::Radio : StreamKind::Live, chunksize);
+    }
+    kodi::Log(ADDON_LOG_DEBUG, "%s:%d: %d", __FUNCTION__, __LINE__, chunksize);
+    return error;
   }
   return PVR_ERROR_UNKNOWN;
 }
@@ -892,7 +1173,10 @@ PVR_ERROR cPVRClientNextPVR::GetRecordings(bool deleted, kodi::addon::PVRRecordi
 
 PVR_ERROR cPVRClientNextPVR::DeleteRecording(const kodi::addon::PVRRecording& recording)
 {
-  return m_recordings.DeleteRecording(recording);
+  const PVR_ERROR error = m_recordings.DeleteRecording(recording);
+  if (error == PVR_ERROR_NO_ERROR)
+    ExpectChanges();
+  return error;
 }
 
 PVR_ERROR cPVRClientNextPVR::GetRecordingEdl(const kodi::addon::PVRRecording& recording, std::vector<kodi::addon::PVREDLEntry>& edl)
@@ -934,17 +1218,26 @@ PVR_ERROR cPVRClientNextPVR::GetTimers(kodi::addon::PVRTimersResultSet& results)
 
 PVR_ERROR cPVRClientNextPVR::AddTimer(const kodi::addon::PVRTimer& timer)
 {
-  return m_timers.AddTimer(timer);
+  const PVR_ERROR error = m_timers.AddTimer(timer);
+  if (error == PVR_ERROR_NO_ERROR)
+    ExpectChanges();
+  return error;
 }
 
 PVR_ERROR cPVRClientNextPVR::DeleteTimer(const kodi::addon::PVRTimer& timer, bool forceDelete)
 {
-  return m_timers.DeleteTimer(timer, forceDelete);
+  const PVR_ERROR error = m_timers.DeleteTimer(timer, forceDelete);
+  if (error == PVR_ERROR_NO_ERROR)
+    ExpectChanges();
+  return error;
 }
 
 PVR_ERROR cPVRClientNextPVR::UpdateTimer(const kodi::addon::PVRTimer& timer)
 {
-  return m_timers.UpdateTimer(timer);
+  const PVR_ERROR error = m_timers.UpdateTimer(timer);
+  if (error == PVR_ERROR_NO_ERROR)
+    ExpectChanges();
+  return error;
 }
 
 //-- GetCapabilities -----------------------------------------------------
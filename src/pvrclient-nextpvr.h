@@ -22,9 +22,12 @@
 #include "Settings.h"
 #include "Timers.h"
 #include "buffers/ClientTimeshift.h"
+#include "buffers/BlockTimeshift.h"
+#include "buffers/LocalTimeshift.h"
 #include "buffers/DummyBuffer.h"
 #include "buffers/RecordingBuffer.h"
 #include "buffers/TranscodedBuffer.h"
+#include "utilities/ChangeMonitor.h"
 #include <map>
 
 enum eNowPlaying
@@ -89,10 +92,14 @@ public:
   int64_t SeekRecordedStream(int64_t position, int whence) override;
   int64_t LengthRecordedStream() override;
 
-  void ForceRecordingUpdate() { m_lastRecordingUpdateTime = 0; }
+  void ForceRecordingUpdate();
+  void ExpectChanges();
 
   /* background connection monitoring */
-  void Process();
+  std::chrono::milliseconds Process();
+  void ExpediteProcess(time_t deadline);
+  void ExpectStandbyDeadline();
+  std::chrono::milliseconds CheckForChanges();
 
   Channels& m_channels = Channels::GetInstance();
   EPG& m_epg = EPG::GetInstance();
@@ -140,8 +147,9 @@ private:
   const CNextPVRAddon& m_base;
 
   bool m_bConnected;
-  std::atomic<bool> m_running = {false};
-  std::thread m_thread;
+  uint64_t m_processTask = 0;
+  uint64_t m_changeTask = 0;
+  NextPVR::utilities::ChangeMonitor m_changeMonitor;
   bool m_supportsLiveTimeshift;
 
   int m_timeShiftBufferSeconds;
@@ -150,6 +158,29 @@ private:
   timeshift::Buffer* m_realTimeBuffer;
   timeshift::RecordingBuffer* m_recordingBuffer;
 
+  // warm standby, the predicted next channel streams on a spare tuner until it is wanted
+  timeshift::Buffer* m_standbyBuffer;
+  std::mutex m_standbyMutex;
+  std::thread m_standbyThread;
+  std::atomic<bool> m_standbyRunning = {false};
+  std::atomic<bool> m_standbyReady = {false};
+  std::atomic<int> m_standbyChannel = {0};
+  // set by the drain thread as it leaves, so stopping it can give up on a stalled read
+  std::mutex m_standbyDrainMutex;
+  std::condition_variable m_standbyDrainStopped;
+  bool m_standbyDrainDone = true;
+  int m_lastLiveChannel = 0;
+  int m_standbyZaps = 0;
+  int m_standbyHits = 0;
+  std::atomic<time_t> m_standbyBackoff = {0};
+  std::atomic<time_t> m_standbyIdleSince = {0};
+  bool TakeStandby(int channelUid);
+  void StartStandby(const kodi::addon::PVRChannel& channel);
+  void ReleaseStandby();
+  bool StopStandbyDrain();
+  bool TimerStartsSoon() const;
+  time_t StandbyDeadline() const;
+
   //Matrix changes
   NextPVR::Settings& m_settings = NextPVR::Settings::GetInstance();
   NextPVR::Request& m_request = NextPVR::Request::GetInstance();
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChangeMonitor.h"
+#include <algorithm>
+
+using namespace NextPVR::utilities;
+
+void ChangeMonitor::Activity()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_fastUntil = Clock::now() + std::chrono::seconds(CHANGE_FAST_PERIOD);
+  m_idle = std::chrono::seconds(CHANGE_POLL_NORMAL);
+}
+
+void ChangeMonitor::Pause()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_paused = true;
+}
+
+void ChangeMonitor::Resume(std::chrono::seconds delay)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_paused = false;
+  m_resumeAt = Clock::now() + delay;
+  m_idle = std::chrono::seconds(CHANGE_POLL_NORMAL);
+}
+
+bool ChangeMonitor::Paused() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_paused || Clock::now() < m_resumeAt;
+}
+
+std::chrono::seconds ChangeMonitor::Polled(bool changed)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (changed)
+    m_idle = std::chrono::seconds(CHANGE_POLL_NORMAL);
+  else
+    m_idle = std::min(m_idle * 3 / 2, std::chrono::seconds(CHANGE_POLL_IDLE));
+  return IntervalLocked();
+}
+
+std::chrono::seconds ChangeMonitor::Interval() const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return IntervalLocked();
+}
+
+std::chrono::seconds ChangeMonitor::IntervalLocked() const
+{
+  const Clock::time_point now = Clock::now();
+  if (now < m_fastUntil)
+    return std::chrono::seconds(CHANGE_POLL_FAST);
+  if (now < m_resumeAt)
+    return std::chrono::duration_cast<std::chrono::seconds>(m_resumeAt - now) + std::chrono::seconds(1);
+  return m_idle;
+}
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AddonBase.h>
+#include <chrono>
+#include <mutex>
+
+// seconds between checks of the backend change token
+#define CHANGE_POLL_FAST 5
+#define CHANGE_POLL_NORMAL 60
+#define CHANGE_POLL_IDLE 180
+// how long fast checks last after the user changed something
+#define CHANGE_FAST_PERIOD 120
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/* \brief Decides how often to ask the backend whether anything changed.
+
+   Right after the user adds a timer or deletes a recording the backend follows up with its own
+   changes, so checks are fast for a while. Each quiet check after that waits a little longer, up
+   to CHANGE_POLL_IDLE, and a change drops back to CHANGE_POLL_NORMAL. Nothing is checked while
+   the system sleeps or for a short time after it wakes.
+*/
+class ATTR_DLL_LOCAL ChangeMonitor
+{
+public:
+  /* \brief The user changed something, check fast for a while. */
+  void Activity();
+
+  /* \brief Stop checking until Resume. */
+  void Pause();
+
+  /* \brief Check again, the first time after delay. */
+  void Resume(std::chrono::seconds delay);
+
+  /* \return true while checks should be skipped */
+  bool Paused() const;
+
+  /* \brief Account for one check.
+     \return the time until the next one
+  */
+  std::chrono::seconds Polled(bool changed);
+
+  /* \return the time until the next check without accounting for one */
+  std::chrono::seconds Interval() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  std::chrono::seconds IntervalLocked() const;
+
+  mutable std::mutex m_mutex;
+  bool m_paused = false;
+  Clock::time_point m_resumeAt;
+  Clock::time_point m_fastUntil;
+  std::chrono::seconds m_idle = std::chrono::seconds(CHANGE_POLL_NORMAL);
+};
+
+} // namespace utilities
+} // namespace NextPVR
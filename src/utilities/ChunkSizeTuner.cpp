@@ -0,0 +1,85 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "ChunkSizeTuner.h"
+#include "../Settings.h"
+#include <algorithm>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+  const char* KIND_NAMES[] = { "live", "radio", "recording" };
+  // reads needed before a stream says anything about the connection
+  const int64_t MINIMUM_READS = 64;
+  // a read should take this many times its fixed cost, within these bounds
+  const double OVERHEAD_FACTOR = 8.0;
+  const double MINIMUM_SECONDS = 0.005;
+  const double MAXIMUM_SECONDS = 0.1;
+}
+
+void ChunkSizeTuner::Start(StreamKind kind)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Stats& stats = m_stats[static_cast<int>(kind)];
+  const int chosen = stats.chosen;
+  stats = Stats();
+  stats.chosen = chosen;
+}
+
+void ChunkSizeTuner::Sample(StreamKind kind, size_t bytes, std::chrono::steady_clock::duration latency)
+{
+  if (bytes == 0)
+    return;
+  const double seconds = std::chrono::duration<double>(latency).count();
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Stats& stats = m_stats[static_cast<int>(kind)];
+  stats.bytes += bytes;
+  stats.reads++;
+  stats.seconds += seconds;
+  if (stats.reads == 1 || seconds < stats.minLatency)
+    stats.minLatency = seconds;
+}
+
+int ChunkSizeTuner::Suggest(const Stats& stats) const
+{
+  if (stats.reads < MINIMUM_READS || stats.seconds <= 0)
+    return 0;
+  const double rate = stats.bytes / stats.seconds;
+  const double target = std::min(std::max(stats.minLatency * OVERHEAD_FACTOR, MINIMUM_SECONDS), MAXIMUM_SECONDS);
+  int chunk = static_cast<int>(std::min(rate * target, static_cast<double>(CHUNK_MAXIMUM)));
+  chunk -= chunk % CHUNK_MINIMUM;
+  return std::max(chunk, CHUNK_MINIMUM);
+}
+
+void ChunkSizeTuner::Stop(StreamKind kind)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  Stats& stats = m_stats[static_cast<int>(kind)];
+  const int suggested = Suggest(stats);
+  if (stats.reads > 0)
+  {
+    kodi::Log(ADDON_LOG_INFO, "Chunk size %s: %lld reads %lld bytes %.0f KB/s min latency %.2f ms, using %d next %d",
+              KIND_NAMES[static_cast<int>(kind)], stats.reads, stats.bytes, stats.seconds > 0 ? stats.bytes / stats.seconds / 1024 : 0.0,
+              stats.minLatency * 1000, stats.chosen, suggested);
+  }
+  if (suggested != 0)
+  {
+    // move halfway so one odd stream does not swing it
+    stats.chosen = stats.chosen == 0 ? suggested : (stats.chosen + suggested) / 2;
+    stats.chosen -= stats.chosen % CHUNK_MINIMUM;
+  }
+}
+
+int ChunkSizeTuner::ChunkSize(StreamKind kind, int manual)
+{
+  if (!NextPVR::Settings::GetInstance().m_chunkAuto)
+    return manual;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const int chosen = m_stats[static_cast<int>(kind)].chosen;
+  return chosen != 0 ? chosen : manual;
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AddonBase.h>
+#include <chrono>
+#include <mutex>
+
+#define CHUNK_MINIMUM (16 * 1024)
+#define CHUNK_MAXIMUM (256 * 1024)
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+enum class StreamKind
+{
+  Live = 0,
+  Radio = 1,
+  Recording = 2,
+  Count = 3
+};
+
+/* \brief Learns a read size per kind of stream.
+
+   Each read Kodi makes is timed. The smallest latency seen stands in for the fixed cost of a
+   read, the bytes over the time spent reading for the throughput. The chunk picked takes long
+   enough to transfer that the fixed cost is small next to it, but not so long that the first
+   read of a stream holds up playback. What a stream learns is used from the next open on.
+*/
+class ATTR_DLL_LOCAL ChunkSizeTuner
+{
+public:
+  static ChunkSizeTuner& GetInstance()
+  {
+    static ChunkSizeTuner tuner;
+    return tuner;
+  }
+
+  /* \brief Start measuring a new stream of this kind. */
+  void Start(StreamKind kind);
+
+  /* \brief Account for one read. */
+  void Sample(StreamKind kind, size_t bytes, std::chrono::steady_clock::duration latency);
+
+  /* \brief Stop measuring, log what was seen and keep the chunk size it suggests. */
+  void Stop(StreamKind kind);
+
+  /* \return the learned chunk size, or manual when tuning is off or nothing is known yet */
+  int ChunkSize(StreamKind kind, int manual);
+
+private:
+  ChunkSizeTuner() = default;
+
+  ChunkSizeTuner(ChunkSizeTuner const&) = delete;
+  void operator=(ChunkSizeTuner const&) = delete;
+
+  struct Stats
+  {
+    int64_t bytes = 0;
+    int64_t reads = 0;
+    double seconds = 0;
+    double minLatency = 0;
+    int chosen = 0;
+  };
+
+  int Suggest(const Stats& stats) const;
+
+  std::mutex m_mutex;
+  Stats m_stats[static_cast<int>(StreamKind::Count)];
+};
+
+} // namespace utilities
+} // namespace NextPVR
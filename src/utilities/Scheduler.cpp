@@ -0,0 +1,139 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "Scheduler.h"
+
+#include <algorithm>
+
+using namespace NextPVR::utilities;
+
+const std::chrono::milliseconds Scheduler::Done(-1);
+
+Scheduler::TaskId Scheduler::Schedule(std::chrono::milliseconds delay, Task task)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_thread.joinable())
+  {
+    m_stopping = false;
+    m_thread = std::thread([this] { Worker(); });
+  }
+  const TaskId id = m_nextId++;
+  const Clock::time_point due = Clock::now() + delay;
+  m_tasks.emplace(id, Entry{ std::move(task), due });
+  m_queue.emplace(due, id);
+  m_wake.notify_one();
+  return id;
+}
+
+void Scheduler::Unqueue(TaskId id, Clock::time_point due)
+{
+  auto range = m_queue.equal_range(due);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (it->second == id)
+    {
+      m_queue.erase(it);
+      return;
+    }
+  }
+}
+
+void Scheduler::Cancel(TaskId id)
+{
+  if (id == 0)
+    return;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_tasks.find(id);
+  if (it != m_tasks.end())
+  {
+    Unqueue(id, it->second.due);
+    m_tasks.erase(it);
+  }
+  // a task cancelling itself just is not run again
+  if (std::this_thread::get_id() != m_thread.get_id())
+    m_finished.wait(lock, [&] { return m_running != id; });
+}
+
+void Scheduler::Expedite(TaskId id, std::chrono::milliseconds delay)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto it = m_tasks.find(id);
+  if (it == m_tasks.end())
+    return;
+  const Clock::time_point due = Clock::now() + delay;
+  if (m_running == id)
+  {
+    it->second.expedite = std::min(it->second.expedite, due);
+    return;
+  }
+  if (it->second.due <= due)
+    return;
+  Unqueue(id, it->second.due);
+  it->second.due = due;
+  m_queue.emplace(due, id);
+  m_wake.notify_one();
+}
+
+void Scheduler::Stop()
+{
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    if (!m_tasks.empty())
+      kodi::Log(ADDON_LOG_DEBUG, "Scheduler stopping with %zu tasks", m_tasks.size());
+    m_tasks.clear();
+    m_queue.clear();
+  }
+  m_wake.notify_one();
+  if (m_thread.joinable() && std::this_thread::get_id() != m_thread.get_id())
+    m_thread.join();
+}
+
+void Scheduler::Worker()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stopping)
+  {
+    if (m_queue.empty())
+    {
+      m_wake.wait(lock);
+      continue;
+    }
+    const Clock::time_point due = m_queue.begin()->first;
+    if (due > Clock::now())
+    {
+      m_wake.wait_until(lock, due);
+      continue;
+    }
+    const TaskId id = m_queue.begin()->second;
+    m_queue.erase(m_queue.begin());
+    auto it = m_tasks.find(id);
+    if (it == m_tasks.end())
+      continue;
+
+    Task task = it->second.task;
+    m_running = id;
+    lock.unlock();
+    const std::chrono::milliseconds delay = task();
+    lock.lock();
+    m_running = 0;
+    m_finished.notify_all();
+
+    // it may have been cancelled while running
+    it = m_tasks.find(id);
+    if (it == m_tasks.end())
+      continue;
+    if (delay < std::chrono::milliseconds(0))
+    {
+      m_tasks.erase(it);
+      continue;
+    }
+    it->second.due = std::min(Clock::now() + delay, it->second.expedite);
+    it->second.expedite = Clock::time_point::max();
+    m_queue.emplace(it->second.due, id);
+  }
+}
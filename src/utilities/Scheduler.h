@@ -0,0 +1,105 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AddonBase.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/* \brief Runs the addon's periodic work on one thread.
+
+   A task is a function returning how long until it wants to run again, or Scheduler::Done. Tasks
+   are kept ordered by deadline and the thread sleeps until the earliest one, so nothing wakes up
+   just to find there is nothing to do. Tasks run one at a time, so a task that waits on the
+   backend holds up every other task on the same instance.
+
+   GetInstance() is for background work that may block on the network, connection checks, change
+   polling and EPG refresh. GetLeaseInstance() only runs the stream leases of open buffers, which
+   must be renewed on time while the background work waits on a slow backend.
+*/
+class ATTR_DLL_LOCAL Scheduler
+{
+public:
+  using TaskId = uint64_t;
+  using Task = std::function<std::chrono::milliseconds()>;
+
+  static const std::chrono::milliseconds Done;
+
+  static Scheduler& GetInstance()
+  {
+    static Scheduler scheduler;
+    return scheduler;
+  }
+
+  static Scheduler& GetLeaseInstance()
+  {
+    static Scheduler scheduler;
+    return scheduler;
+  }
+
+  /* \brief Run task after delay.
+     \return an id for Cancel, never 0
+  */
+  TaskId Schedule(std::chrono::milliseconds delay, Task task);
+
+  /* \brief Remove a task. When it is running this waits for it to return, unless called from the
+     task itself, so its owner can be destroyed right after.
+  */
+  void Cancel(TaskId id);
+
+  /* \brief Run a task within delay when it is due later than that. A running task runs again no
+     later than that once it returns, unless it returns Done.
+  */
+  void Expedite(TaskId id, std::chrono::milliseconds delay);
+
+  /* \brief Drop every task and stop the thread, the next Schedule starts it again. */
+  void Stop();
+
+private:
+  Scheduler() = default;
+  ~Scheduler() { Stop(); }
+
+  Scheduler(Scheduler const&) = delete;
+  void operator=(Scheduler const&) = delete;
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry
+  {
+    Task task;
+    Clock::time_point due;
+    // asked for while running
+    Clock::time_point expedite = Clock::time_point::max();
+  };
+
+  void Worker();
+  void Unqueue(TaskId id, Clock::time_point due);
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_finished;
+  std::multimap<Clock::time_point, TaskId> m_queue;
+  std::unordered_map<TaskId, Entry> m_tasks;
+  TaskId m_nextId = 1;
+  TaskId m_running = 0;
+  bool m_stopping = false;
+  std::thread m_thread;
+};
+
+} // namespace utilities
+} // namespace NextPVR
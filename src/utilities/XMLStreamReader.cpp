@@ -0,0 +1,113 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#include "XMLStreamReader.h"
+
+using namespace NextPVR::utilities;
+
+XMLStreamReader::XMLStreamReader(const std::string& element, ElementHandler handler) :
+  m_openTag("<" + element),
+  m_closeTag("</" + element + ">"),
+  m_handler(handler)
+{
+}
+
+size_t XMLStreamReader::FindOpenTag(size_t from) const
+{
+  // <l> must not match <listings>
+  size_t pos = m_pending.find(m_openTag, from);
+  while (pos != std::string::npos && pos + m_openTag.length() < m_pending.length())
+  {
+    const char next = m_pending[pos + m_openTag.length()];
+    if (next == '>' || next == '/' || next == ' ' || next == '\t' || next == '\r' || next == '\n')
+      return pos;
+    pos = m_pending.find(m_openTag, pos + 1);
+  }
+  return pos;
+}
+
+bool XMLStreamReader::Feed(const char* data, size_t length)
+{
+  if (m_error != tinyxml2::XML_SUCCESS)
+    return false;
+
+  m_bytesRead += length;
+  m_pending.append(data, length);
+
+  while (true)
+  {
+    if (!m_insideElement)
+    {
+      const size_t start = FindOpenTag(m_scanPos);
+      if (start == std::string::npos || start + m_openTag.length() >= m_pending.length())
+      {
+        // keep enough to complete an open tag split across chunks
+        const size_t keep = start != std::string::npos ? m_pending.length() - start : std::min(m_pending.length(), m_openTag.length());
+        m_envelope.append(m_pending, 0, m_pending.length() - keep);
+        m_pending.erase(0, m_pending.length() - keep);
+        m_scanPos = 0;
+        return true;
+      }
+      m_envelope.append(m_pending, 0, start);
+      m_pending.erase(0, start);
+      m_insideElement = true;
+      m_scanPos = m_openTag.length();
+    }
+
+    size_t end = std::string::npos;
+    const size_t tagEnd = m_pending.find('>', m_openTag.length());
+    if (tagEnd == std::string::npos)
+    {
+      m_scanPos = m_openTag.length();
+      return true;
+    }
+    if (m_pending[tagEnd - 1] == '/')
+    {
+      end = tagEnd + 1;
+    }
+    else
+    {
+      const size_t close = m_pending.find(m_closeTag, std::max(m_scanPos, tagEnd));
+      if (close != std::string::npos)
+        end = close + m_closeTag.length();
+    }
+
+    if (end == std::string::npos)
+    {
+      // resume the search where this one stopped next time
+      m_scanPos = m_pending.length() >= m_closeTag.length() ? m_pending.length() - m_closeTag.length() + 1 : 0;
+      return true;
+    }
+
+    m_element.Clear();
+    m_error = m_element.Parse(m_pending.c_str(), end);
+    if (m_error != tinyxml2::XML_SUCCESS)
+    {
+      kodi::Log(ADDON_LOG_ERROR, "XMLStreamReader cannot parse %s element %d", m_openTag.c_str() + 1, m_elementCount);
+      return false;
+    }
+    m_elementCount++;
+    m_handler(m_element.RootElement());
+    m_pending.erase(0, end);
+    m_insideElement = false;
+    m_scanPos = 0;
+  }
+}
+
+tinyxml2::XMLError XMLStreamReader::Finish(tinyxml2::XMLDocument& envelope)
+{
+  if (m_error != tinyxml2::XML_SUCCESS)
+    return m_error;
+  if (m_insideElement)
+  {
+    kodi::Log(ADDON_LOG_ERROR, "XMLStreamReader truncated %s element", m_openTag.c_str() + 1);
+    return tinyxml2::XML_ERROR_PARSING_ELEMENT;
+  }
+  m_envelope.append(m_pending);
+  m_pending.clear();
+  return envelope.Parse(m_envelope.c_str(), m_envelope.length());
+}
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2005-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+#pragma once
+
+#include <kodi/AddonBase.h>
+#include <functional>
+#include <string>
+#include <tinyxml2.h>
+
+namespace NextPVR
+{
+namespace utilities
+{
+
+/* \brief Incremental reader for backend list responses.
+
+   Bytes are fed as they arrive from the network. Every complete <element> is parsed on its own
+   and passed to the handler, then discarded, so a large list is never held as one DOM. Everything
+   outside the streamed elements (the rsp envelope, counts, errors) is kept and parsed by Finish().
+   The streamed element must not nest inside itself.
+*/
+class ATTR_DLL_LOCAL XMLStreamReader
+{
+public:
+  using ElementHandler = std::function<void(const tinyxml2::XMLElement*)>;
+
+  XMLStreamReader(const std::string& element, ElementHandler handler);
+
+  /* \brief Consume the next chunk of the response.
+     \return false once an element failed to parse, further data is ignored
+  */
+  bool Feed(const char* data, size_t length);
+
+  /* \brief Parse what remains of the response once the transfer is complete.
+     \param[out] envelope the response without the streamed elements
+  */
+  tinyxml2::XMLError Finish(tinyxml2::XMLDocument& envelope);
+
+  int GetElementCount() const { return m_elementCount; }
+  size_t GetBytesRead() const { return m_bytesRead; }
+
+private:
+  size_t FindOpenTag(size_t from) const;
+
+  const std::string m_openTag;
+  const std::string m_closeTag;
+  ElementHandler m_handler;
+  tinyxml2::XMLDocument m_element;
+  std::string m_pending;
+  std::string m_envelope;
+  size_t m_scanPos = 0;
+  bool m_insideElement = false;
+  tinyxml2::XMLError m_error = tinyxml2::XML_SUCCESS;
+  int m_elementCount = 0;
+  size_t m_bytesRead = 0;
+};
+
+} // namespace utilities
+} // namespace NextPVR
@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <tinyxml2.h>
@@ -185,6 +186,38 @@ inline bool GetBoolean(const tinyxml2::XMLNode* pRootNode, const std::string& st
   }
   return true;
 }
+
+/* \brief Find several child elements in one walk over the children instead of one search each.
+
+   \param[in] pRootNode the parent element
+   \param[in] names the tags to look for
+   \param[in] count number of names
+   \param[out] elements the first child with each name, nullptr when there is none
+   \return number of names found
+*/
+inline int GetChildElements(const tinyxml2::XMLElement* pRootNode, const char* const names[], int count, const tinyxml2::XMLElement* elements[])
+{
+  std::fill(elements, elements + count, nullptr);
+  int found = 0;
+  for (const tinyxml2::XMLElement* child = pRootNode->FirstChildElement(); child && found < count; child = child->NextSiblingElement())
+  {
+    const char* name = child->Name();
+    for (int i = 0; i < count; i++)
+    {
+      if (strcmp(name, names[i]) == 0)
+      {
+        if (elements[i] == nullptr)
+        {
+          elements[i] = child;
+          found++;
+        }
+        break;
+      }
+    }
+  }
+  return found;
+}
+
 //------------------------------------------------------------------------------
 
 } /* namespace XMLUtils */
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+// Times the two ways of reading the fields of a channel.listings <l> element:
+// one FirstChildElement search and string copy per field as EPG.cpp used to,
+// against the single child walk ListingDecoder does now.
+
+#include <kodi/tools/StringUtils.h>
+#include "utilities/XMLUtils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace NextPVR::utilities;
+
+namespace
+{
+  const char* const listingFields[] = { "name", "description", "subtitle", "year", "start", "end", "genre", "genre_type", "genre_sub_type",
+                                        "season", "episode", "original", "firstrun", "significance", "cast", "crew", "star_rating", "genres" };
+  const int FieldCount = sizeof(listingFields) / sizeof(listingFields[0]);
+
+  std::string MakeListings(int count)
+  {
+    std::string xml = "<rsp stat=\"ok\"><listings>";
+    for (int i = 0; i < count; i++)
+    {
+      const std::string n = std::to_string(i);
+      xml += "<l><id>" + n + "</id><name>Programme title " + std::to_string(i % 300) + "</name>"
+             "<description>Episode " + n + ": a description long enough to look like a real guide entry for one programme.</description>"
+             "<subtitle>Episode " + n + "</subtitle><start>" + std::to_string(1600000000000LL + i * 1800000LL) + "</start>"
+             "<end>" + std::to_string(1600001800000LL + i * 1800000LL) + "</end><genre>Drama</genre><genre_type>16</genre_type>"
+             "<genre_sub_type>0</genre_sub_type><season>" + std::to_string(i % 9 + 1) + "</season><episode>" + std::to_string(i % 24 + 1) + "</episode>"
+             "<original>2020-01-01</original><firstrun>true</firstrun><significance>Premiere</significance><year>2020</year>"
+             "<cast>Actor One, Actor Two, Actor Three</cast><crew>Director: Someone, Writer: Someone Else</crew><star_rating>3.5/4</star_rating>"
+             "<genres><genre>Drama</genre><genre>Crime</genre></genres></l>";
+    }
+    xml += "</listings></rsp>";
+    return xml;
+  }
+
+  size_t LookupEachField(const tinyxml2::XMLElement* listing)
+  {
+    // locals per listing like the old loop in EPG.cpp
+    std::string title, description, subtitle, start, end, genre, original, significance, cast, crew, rating, genres;
+    XMLUtils::GetString(listing, "name", title);
+    XMLUtils::GetString(listing, "description", description);
+    XMLUtils::GetString(listing, "subtitle", subtitle);
+    XMLUtils::GetString(listing, "start", start);
+    XMLUtils::GetString(listing, "end", end);
+    XMLUtils::GetString(listing, "genre", genre);
+    XMLUtils::GetString(listing, "original", original);
+    XMLUtils::GetString(listing, "significance", significance);
+    XMLUtils::GetString(listing, "cast", cast);
+    XMLUtils::GetString(listing, "crew", crew);
+    XMLUtils::GetString(listing, "star_rating", rating);
+    XMLUtils::GetAdditiveString(listing->FirstChildElement("genres"), "genre", ",", genres, true);
+    const int numbers = XMLUtils::GetIntValue(listing, "year") + XMLUtils::GetIntValue(listing, "genre_type") + XMLUtils::GetIntValue(listing, "genre_sub_type") +
+                        XMLUtils::GetIntValue(listing, "season") + XMLUtils::GetIntValue(listing, "episode");
+    bool firstrun;
+    XMLUtils::GetBoolean(listing, "firstrun", firstrun);
+    return title.size() + description.size() + genres.size() + numbers + firstrun;
+  }
+
+  size_t WalkOnce(const tinyxml2::XMLElement* listing, std::string& genres)
+  {
+    const tinyxml2::XMLElement* elements[FieldCount];
+    XMLUtils::GetChildElements(listing, listingFields, FieldCount, elements);
+    size_t total = 0;
+    int numbers = 0;
+    for (int field = 0; field < FieldCount - 1; field++)
+    {
+      const char* text = elements[field] ? elements[field]->GetText() : nullptr;
+      if (text == nullptr)
+        continue;
+      total += strlen(text);
+      numbers += atoi(text);
+    }
+    genres.clear();
+    if (elements[FieldCount - 1])
+    {
+      for (const tinyxml2::XMLElement* genre = elements[FieldCount - 1]->FirstChildElement("genre"); genre; genre = genre->NextSiblingElement("genre"))
+      {
+        if (!genres.empty())
+          genres += ',';
+        genres += genre->GetText();
+      }
+    }
+    return total + genres.size() + numbers;
+  }
+
+  template<typename F>
+  double Time(const tinyxml2::XMLElement* listings, int rounds, size_t& check, F decode)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+      for (const tinyxml2::XMLElement* listing = listings->FirstChildElement("l"); listing; listing = listing->NextSiblingElement("l"))
+        check += decode(listing);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  const int count = argc > 1 ? atoi(argv[1]) : 20000;
+  const int rounds = 10;
+  const std::string xml = MakeListings(count);
+  tinyxml2::XMLDocument doc;
+  if (doc.Parse(xml.c_str(), xml.size()) != tinyxml2::XML_SUCCESS)
+  {
+    fprintf(stderr, "parse failed\n");
+    return 1;
+  }
+  const tinyxml2::XMLElement* listings = doc.RootElement()->FirstChildElement("listings");
+
+  size_t checkLookup = 0;
+  size_t checkWalk = 0;
+  std::string genres;
+  const double lookup = Time(listings, rounds, checkLookup, LookupEachField);
+  const double walk = Time(listings, rounds, checkWalk, [&genres](const tinyxml2::XMLElement* listing) { return WalkOnce(listing, genres); });
+
+  const double decoded = static_cast<double>(count) * rounds;
+  printf("%d listings x %d rounds\n", count, rounds);
+  printf("lookup per field  %8.0f ns/listing\n", lookup * 1e9 / decoded);
+  printf("single walk       %8.0f ns/listing  (%.1fx)\n", walk * 1e9 / decoded, lookup / walk);
+  // printed so the work is not optimised away
+  printf("sinks %zu %zu\n", checkLookup, checkWalk);
+  return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+// Pushes the same bytes from a producer thread to a consumer through the
+// mutex guarded CircularBuffer the client timeshift used to have, and through
+// the lock free RingBuffer that replaced it, in stream sized writes and Kodi
+// sized reads.
+
+#include "buffers/CircularBuffer.h"
+#include "buffers/RingBuffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace timeshift;
+
+// normally defined by ADDONCREATOR, the buffers only use it to log
+AddonGlobalInterface* kodi::addon::CPrivateBase::m_interface = nullptr;
+
+namespace
+{
+  const size_t WRITE_SIZE = 64 * 1024;
+  const size_t READ_SIZE = 32 * 1024;
+  const size_t RING_SIZE = 32 * 1024 * 1024;
+
+  std::vector<byte> source;
+
+  void DiscardLog(const KODI_HANDLE, const int, const char*) {}
+
+  void Fill(byte* buffer, size_t length, uint64_t offset)
+  {
+    memcpy(buffer, source.data() + offset % (WRITE_SIZE * 16), length);
+  }
+
+  // spot check each read against what the producer wrote at that offset
+  int Mismatches(const byte* buffer, size_t length, uint64_t offset)
+  {
+    return (buffer[0] != source[offset % (WRITE_SIZE * 16)]) + (buffer[length - 1] != source[(offset + length - 1) % (WRITE_SIZE * 16)]);
+  }
+
+  double CircularPath(uint64_t total, int& errors)
+  {
+    CircularBuffer ring(static_cast<int>(RING_SIZE));
+    std::mutex mutex;
+    std::condition_variable space;
+    std::condition_variable data;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]()
+    {
+      std::vector<byte> chunk(WRITE_SIZE);
+      for (uint64_t written = 0; written < total; written += WRITE_SIZE)
+      {
+        Fill(chunk.data(), WRITE_SIZE, written);
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [&] { return ring.BytesFree() >= static_cast<int>(WRITE_SIZE); });
+        ring.WriteBytes(chunk.data(), static_cast<int>(WRITE_SIZE));
+        data.notify_one();
+      }
+    });
+    std::vector<byte> out(READ_SIZE);
+    for (uint64_t read = 0; read < total;)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      data.wait(lock, [&] { return ring.BytesAvailable() > 0; });
+      const int length = ring.ReadBytes(out.data(), std::min(static_cast<int>(READ_SIZE), ring.BytesAvailable()));
+      lock.unlock();
+      space.notify_one();
+      errors += Mismatches(out.data(), length, read);
+      read += length;
+    }
+    producer.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  double RingPath(uint64_t total, int& errors, bool& mirrored)
+  {
+    RingBuffer ring(RING_SIZE);
+    mirrored = ring.IsMirrored();
+    // only used to sleep when one side is ahead, the data itself is never locked
+    std::mutex mutex;
+    std::condition_variable space;
+    std::condition_variable data;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread producer([&]()
+    {
+      for (uint64_t written = 0; written < total;)
+      {
+        if (ring.BytesFree() < WRITE_SIZE)
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          space.wait(lock, [&] { return ring.BytesFree() >= WRITE_SIZE; });
+        }
+        size_t span;
+        byte* target = ring.WriteSpan(span);
+        const size_t length = std::min(span, WRITE_SIZE);
+        Fill(target, length, written);
+        ring.CommitWrite(length);
+        written += length;
+        std::unique_lock<std::mutex> lock(mutex);
+        data.notify_one();
+      }
+    });
+    std::vector<byte> out(READ_SIZE);
+    for (uint64_t read = 0; read < total;)
+    {
+      if (ring.BytesAvailable() == 0)
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        data.wait(lock, [&] { return ring.BytesAvailable() > 0; });
+      }
+      const size_t length = ring.Read(out.data(), READ_SIZE);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.notify_one();
+      }
+      errors += Mismatches(out.data(), length, read);
+      read += length;
+    }
+    producer.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+} // unnamed namespace
+
+int main(int argc, char* argv[])
+{
+  // optionally the number of MB to move per run
+  const uint64_t total = static_cast<uint64_t>(argc > 1 ? atoi(argv[1]) : 4096) * 1024 * 1024;
+  const int rounds = 3;
+
+  AddonToKodiFuncTable_Addon toKodi{};
+  toKodi.addon_log_msg = DiscardLog;
+  AddonGlobalInterface addonInterface{};
+  addonInterface.toKodi = &toKodi;
+  kodi::addon::CPrivateBase::m_interface = &addonInterface;
+
+  source.resize(WRITE_SIZE * 17);
+  for (size_t i = 0; i < source.size(); i++)
+    source[i] = static_cast<byte>(i * 131 + 7);
+
+  const double megabytes = static_cast<double>(total) / (1024 * 1024);
+  printf("%.0f MB through a %zu MB buffer, %zu KB writes, %zu KB reads\n", megabytes, RING_SIZE >> 20, WRITE_SIZE >> 10, READ_SIZE >> 10);
+  for (int round = 0; round < rounds; round++)
+  {
+    int errors = 0;
+    bool mirrored = false;
+    const double circular = CircularPath(total, errors);
+    const double ring = RingPath(total, errors, mirrored);
+    printf("run %d  CircularBuffer+mutex %6.0f MB/s  RingBuffer %6.0f MB/s  mirrored %d  %s\n", round, megabytes / circular,
+           megabytes / ring, mirrored, errors == 0 ? "data ok" : "DATA WRONG");
+  }
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (C) 2020-2021 Team Kodi (https://kodi.tv)
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *  See LICENSE.md for more information.
+ */
+
+// Drives TailFollower against a local file that another thread keeps appending to,
+// the way RecordingBuffer follows an in-progress recording.
+
+#include "buffers/TailFollower.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using timeshift::TailFollower;
+
+namespace
+{
+  int failures = 0;
+
+  void Check(bool condition, const char* what)
+  {
+    if (!condition)
+    {
+      fprintf(stderr, "FAILED: %s\n", what);
+      failures++;
+    }
+  }
+
+  unsigned char Pattern(size_t offset)
+  {
+    return static_cast<unsigned char>(offset * 7 + offset / 251);
+  }
+
+  /* appends blocks to the file with a pause between them */
+  class Writer
+  {
+  public:
+    Writer(const std::string& path, size_t block, int blocks, std::chrono::milliseconds pause)
+    {
+      m_thread = std::thread([=]()
+      {
+        std::vector<unsigned char> data(block);
+        const int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+        for (int i = 0; i < blocks; i++)
+        {
+          std::this_thread::sleep_for(pause);
+          for (size_t j = 0; j < block; j++)
+            data[j] = Pattern(m_written + j);
+          if (write(fd, data.data(), block) != static_cast<ssize_t>(block))
+            break;
+          m_written += block;
+        }
+        close(fd);
+        m_done = true;
+      });
+    }
+    ~Writer() { m_thread.join(); }
+
+    std::atomic<size_t> m_written = { 0 };
+    std::atomic<bool> m_done = { false };
+
+  private:
+    std::thread m_thread;
+  };
+
+  std::string TempFile()
+  {
+    char path[] = "/tmp/tailfollowerXXXXXX";
+    const int fd = mkstemp(path);
+    close(fd);
+    return path;
+  }
+
+  /* reads everything the writer appends, following the tail whenever a read comes back empty */
+  size_t ReadAll(const std::string& path, const TailFollower& follower, size_t expected, int& reopens, bool snapshotHandle)
+  {
+    int fd = open(path.c_str(), O_RDONLY);
+    off_t position = 0;
+    // an HTTP response ends at the length the file had when the request was made
+    off_t responseEnd = snapshotHandle ? lseek(fd, 0, SEEK_END) : -1;
+    lseek(fd, 0, SEEK_SET);
+    auto read = [&](unsigned char* data, size_t size) -> ssize_t
+    {
+      if (responseEnd >= 0)
+        size = std::min(size, static_cast<size_t>(responseEnd - position));
+      const ssize_t got = size == 0 ? 0 : ::read(fd, data, size);
+      if (got > 0)
+        position += got;
+      return got;
+    };
+    auto reopen = [&]() -> bool
+    {
+      reopens++;
+      close(fd);
+      fd = open(path.c_str(), O_RDONLY);
+      if (snapshotHandle)
+        responseEnd = lseek(fd, 0, SEEK_END);
+      return lseek(fd, position, SEEK_SET) == position;
+    };
+
+    std::vector<unsigned char> buffer(4096);
+    size_t total = 0;
+    bool intact = true;
+    while (total < expected)
+    {
+      ssize_t got = read(buffer.data(), buffer.size());
+      if (got == 0)
+        got = follower.Follow(buffer.data(), buffer.size(), read, reopen);
+      if (got == 0)
+        break;
+      for (ssize_t i = 0; i < got; i++)
+        intact = intact && buffer[i] == Pattern(total + i);
+      total += got;
+    }
+    close(fd);
+    Check(intact, "data read back in order");
+    return total;
+  }
+
+  void TestFileFollowsOnOpenHandle()
+  {
+    const std::string path = TempFile();
+    const size_t block = 64 * 1024;
+    const int blocks = 20;
+    int reopens = 0;
+    const auto start = std::chrono::steady_clock::now();
+    size_t total;
+    {
+      Writer writer(path, block, blocks, std::chrono::milliseconds(100));
+      total = ReadAll(path, TailFollower(TailFollower::ForFile()), block * blocks, reopens, false);
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    Check(total == block * blocks, "file: all appended data read");
+    Check(reopens == 0, "file: appended data seen without reopening");
+    // 20 blocks 100 ms apart, the reader should not lag far behind the writer
+    Check(elapsed < 3000, "file: reader kept up with the writer");
+    printf("file: %zu bytes, %d reopens, %lld ms\n", total, reopens, static_cast<long long>(elapsed));
+    unlink(path.c_str());
+  }
+
+  void TestHttpReopens()
+  {
+    const std::string path = TempFile();
+    const size_t block = 64 * 1024;
+    const int blocks = 6;
+    int reopens = 0;
+    size_t total;
+    {
+      Writer writer(path, block, blocks, std::chrono::milliseconds(300));
+      total = ReadAll(path, TailFollower(TailFollower::ForHttp()), block * blocks, reopens, true);
+    }
+    Check(total == block * blocks, "http: all appended data read");
+    Check(reopens > 0, "http: ended response reopened");
+    printf("http: %zu bytes, %d reopens\n", total, reopens);
+    unlink(path.c_str());
+  }
+
+  void TestGivesUpAtLimit()
+  {
+    TailFollower::Policy policy = TailFollower::ForFile();
+    policy.limit = std::chrono::milliseconds(300);
+    policy.reopenInterval = std::chrono::milliseconds(100);
+    int reads = 0;
+    int reopens = 0;
+    unsigned char buffer[16];
+    const auto start = std::chrono::steady_clock::now();
+    const ssize_t got = TailFollower(policy).Follow(buffer, sizeof(buffer),
+      [&reads](unsigned char*, size_t) -> ssize_t { reads++; return 0; },
+      [&reopens]() { reopens++; return true; });
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    Check(got == 0, "limit: nothing read");
+    Check(elapsed >= 300 && elapsed < 1000, "limit: gave up after the limit");
+    Check(reads > 0 && reopens >= 1, "limit: polled and reopened at the interval");
+  }
+} // unnamed namespace
+
+int main()
+{
+  TestFileFollowsOnOpenHandle();
+  TestHttpReopens();
+  TestGivesUpAtLimit();
+  if (failures == 0)
+    printf("all passed\n");
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}